@@ -2,41 +2,105 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <string.h>
 #include <time.h>
 #include <ctype.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <limits.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+  #include <immintrin.h>
+#endif
 
 #ifdef _WIN32
   #include <windows.h>
+  #include <io.h>
+  #include <fcntl.h>
+  #include <direct.h>
+#else
+  #include <fcntl.h>
+  #include <unistd.h>
+  #include <sys/mman.h>
+  #include <pthread.h>
 #endif
 
 #define PRODUCTS_FILE "products.txt"
+#define PRODUCTS_BIN_FILE "products.bin"
+#define STOCK_JOURNAL_FILE "stock.journal"
+#define STOCK_JOURNAL_CHECKPOINT 4096   // journal lines folded into the catalog per checkpoint
 #define RECEIPTS_FILE "receipts.txt"
-#define SALES_ITEMS_FILE "sales_items.txt"
+#define RECEIPT_SEG_DIR "receipts"     // sealed receipt segments
+#define RECEIPT_SEG_MANIFEST RECEIPT_SEG_DIR "/segments.dat"
+#define RECEIPT_SEG_MAX_BYTES (64LL << 20)  // receipts.txt size that forces a rotation
+#define SALES_ITEMS_FILE "sales_items.txt"   // written only by --export-sales-items
+#define CUSTOMERS_FILE "customers.txt"
+#define CUSTOMERS_DB_FILE "customers.dat"
+#define RECEIPT_SEQ_FILE "receipt.seq"
+#define SEQ_TAIL_BYTES 4096     // data file tail read to recover a sequence
+#define SALES_STORE_DIR "sales.col"
+#define SALES_BATCH 4096    // initial rows per sales ingest chunk
+#define ROLLUP_FILE "rollups.dat"
+#define ROLLUP_LOG_FILE "rollups.log"
+#define RECEIPT_INDEX_FILE "receipts.idx"
+#define HISTORY_PAGE 10     // receipts per page of purchase history
 #define BILLS_DIR "bills"
-#define MAX_PRODUCTS 2000
-#define MAX_CART 200
+#define BILL_INDEX_FILE BILLS_DIR "/bills.idx"
+#define DEFAULT_REORDER_LEVEL 5
+#define MAX_CART 100000    // lines per cart
+#define CART_ROW_LEN 192    // rendered steady receipt line
 #define MAX_LINE 512
+#define CSV_BLOCK (1 << 16)     // bytes read per refill
+#define CSV_MAX_FIELDS 16
+#define CENTS_CHARS 24      // buffer for cents_str()
+#define SCAN_CHUNK (8 << 20)    // bytes per parallel scan chunk
+#define SCAN_AHEAD 2    // chunks per thread a scan may run ahead of its merge
 
 /* ---------- Data Structures ---------- */
+/* Amounts are fixed point with two decimals: money in paise, discounts in
+   hundredths of a percent. Text files keep the "123.45" layout. */
+typedef int64_t Money;
+
 typedef struct {
     int code;
     char name[128];
-    double price;
+    Money price;
     int stock;
-    double discount; // percentage
+    int discount; // percentage, in hundredths
     char category[64];
     char subcategory[64];
+    int reorderLevel; // low-stock alert when stock falls below this
 } Product;
 
 typedef struct {
     int code;
     char name[128];
-    int qty;
-    double priceAfterDisc;
-    double total;
+    int qty;        // 0 once removed from the cart
+    Money priceAfterDisc;
+    Money total;
+    char row[CART_ROW_LEN]; // steady receipt line; empty until rendered after a change
 } CartItem;
 
+/* One cashier's open cart; see "Checkout lanes". Lines keep scan order.
+   slot maps a code to its line, so adding, merging and removing are O(1);
+   removed lines stay as qty 0 until lane_pack() squeezes them out. */
+typedef struct {
+    char customer[128];
+    CartItem *cart;
+    int cartCount, cartCap;
+    int live;           // lines with qty > 0
+    Money subtotal;     // of the live lines
+    int *slot;          // 2 * cartCap entries, -1 empty
+    int *moved, *delta; // lane_commit_stock() output, cartCap each
+    int writeBill;  // archive a printed bill at checkout (interactive billing)
+    int lastReceipt;    // receipt id of the last checkout
+} Lane;
+
+enum { LANE_OK = 0, LANE_NO_PRODUCT, LANE_BAD_QTY, LANE_NO_STOCK, LANE_CART_FULL };
+
 /* ---------- Customer Management Data Structures ---------- */
 typedef struct {
     int id;
@@ -46,16 +110,463 @@ typedef struct {
     char address[100];
 } Customer;
 
+/* customers.dat: one CustomerFileHeader followed by `count` Customer
+   records in id order, native byte order. A record's slot never moves,
+   so updates rewrite it in place. */
+#define CUSTOMER_MAGIC "DMCUSTS"
+#define CUSTOMER_VERSION 1
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t count;
+    int32_t lastId;
+} CustomerFileHeader;
+
+/* Name index entry: a word start within a customer's lowercased name. */
+typedef struct {
+    int32_t slot;
+    int32_t off;
+} NameKey;
+
+/* Resident indexes over customers.dat; the records stay on disk. idIndex
+   and phoneIndex are open-addressing tables of slots (-1 empty, -2
+   removed). The name index holds every word start of every name, sorted,
+   so a prefix of the first or last name is a binary search. */
+typedef struct {
+    FILE *fp;
+    int loaded;
+    int count, cap;
+    int lastId;
+    int32_t *id;            // slot -> id
+    uint64_t *phone;        // slot -> normalized phone, 0 if none
+    uint32_t *nameOff;      // slot -> offset into names
+    char *names;            // lowercased names, NUL-terminated
+    size_t namesLen, namesCap;
+    int *idIndex, *phoneIndex;
+    int indexCap;
+    NameKey *byName;        // built on first name search
+    int nameKeys, nameKeysCap, nameIndexed;
+} CustomerStore;
+
+/* ---------- Binary Catalog Format ---------- */
+/* products.bin: one CatalogFileHeader followed by `count` fixed-size
+   ProductRecords in catalog order, native byte order. Versions 1 and 2
+   held price and discount as doubles (version 1 records end before
+   reorderLevel); both are still readable. */
+#define CATALOG_MAGIC "DMCATLG"
+#define CATALOG_VERSION 3
+#define CATALOG_V1_RECORD_SIZE offsetof(ProductRecordV2, reorderLevel)
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t count;
+    uint32_t reserved;
+} CatalogFileHeader;
+
+typedef struct {
+    int32_t code;
+    int32_t stock;
+    int64_t price;      // paise
+    int64_t discount;   // hundredths of a percent
+    char name[128];
+    char category[64];
+    char subcategory[64];
+    int32_t reorderLevel;
+    int32_t reserved;
+} ProductRecord;
+
+typedef struct {
+    int32_t code;
+    int32_t stock;
+    double price;
+    double discount;
+    char name[128];
+    char category[64];
+    char subcategory[64];
+    int32_t reorderLevel;
+    int32_t reserved;
+} ProductRecordV2;
+
+enum { CATALOG_BACKEND_CSV = 0, CATALOG_BACKEND_BIN = 1 };
+
+/* ---------- Shared Containers ---------- */
+/* Sorted list of product indices, used for posting lists. */
+typedef struct {
+    int *ids;
+    int count, cap;
+} IdList;
+
+/* Interned strings: each distinct string gets a small dense id. */
+typedef struct {
+    char *arena;
+    size_t len, cap;
+    uint32_t *off;      // id -> offset into arena
+    int count, offCap;
+    int *slots;         // open addressing, id or -1
+    int slotCap;
+} StrDict;
+
+/* ---------- CSV Reader ---------- */
+/* A field is a slice of the reader's buffer; it is only valid until the
+   next csv_next() call and is not NUL-terminated. */
+typedef struct {
+    const char *p;
+    int len;
+} Field;
+
+/* Streams a delimited text file in CSV_BLOCK reads. Unconsumed bytes are
+   buf[pos, len); a record longer than the buffer grows it. */
+typedef struct {
+    FILE *fp;
+    char *buf;
+    size_t cap, pos, len;
+    int eof;
+    Field f[CSV_MAX_FIELDS];
+    int nf;
+    int torn;   // current record ended at EOF without a newline
+    long long base; // file offset of buf[0]
+} CsvReader;
+
+/* ---------- Receipt Segments ---------- */
+/* The receipt log is a run of sealed segments under receipts/ followed by
+   receipts.txt, the active segment that checkouts append to. The group
+   commit seals receipts.txt when a checkout's day differs from its first
+   line's, or when it would outgrow RECEIPT_SEG_MAX_BYTES. Offsets into the
+   log (sales store, rollups, receipt index) count from the start of the
+   first segment, so sealing and compacting never move a byte. Each sealed
+   segment's zone map in segments.dat lets a scan skip segments that cannot
+   hold a date range or product. The log is the only record of sales; the
+   sales store, rollups and receipt index are views of it, and
+   sales_items.txt is produced from it on demand (--export-sales-items). */
+#define RECEIPT_SEG_MAGIC "DMSEGS"
+#define RECEIPT_SEG_VERSION 1
+#define ZONE_CODE_BITS 8192
+
+typedef struct {
+    int64_t base, bytes;    // log offsets [base, base + bytes); the file is receipts/<base>.txt
+    int64_t lines;
+    int32_t minDay, maxDay; // YYYYMMDD
+    int32_t minRid, maxRid;
+    uint8_t codes[ZONE_CODE_BITS / 8];  // bit code % ZONE_CODE_BITS set for each product sold
+} ReceiptZone;
+
+typedef struct {
+    char magic[8];
+    uint32_t version, recordSize, count, reserved;
+} ReceiptSegHeader;
+
+typedef struct {
+    int loaded;
+    ReceiptZone *zone;      // sealed segments, oldest first
+    int count, cap;
+    int64_t sealedBytes;    // log offset of receipts.txt
+    int activeDay;          // day of receipts.txt's first line, 0 if unknown
+} ReceiptLog;
+
+/* ---------- Columnar Sales Store ---------- */
+/* sales.col/ mirrors the receipt log one column file per field, each a packed
+   native-endian array with one entry per receipt line. Customer and item
+   names are dictionary-encoded: <name>.dict holds one string per line in
+   id order. meta is written last, so rows beyond meta.rows (or dict bytes
+   beyond dictBytes) are leftovers of an interrupted append. */
+#define SALES_MAGIC "DMSALES"
+#define SALES_VERSION 2
+
+enum { SC_RID, SC_DAY, SC_TOD, SC_CODE, SC_QTY, SC_AMOUNT, SC_CUST, SC_ITEM, SALES_COLS };
+enum { SD_CUSTOMER, SD_ITEM, SALES_DICTS };
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t rows;
+    int64_t srcBytes;               // prefix of the receipt log folded in
+    int64_t dictBytes[SALES_DICTS];
+    uint32_t dictCount[SALES_DICTS];
+} SalesMeta;
+
+typedef struct {
+    int loaded;
+    SalesMeta meta;
+    void *col[SALES_COLS];  // read on first use; NULL until then
+    size_t colCap[SALES_COLS];
+    StrDict dict[SALES_DICTS];
+    int dictsLoaded;
+} SalesStore;
+
+/* ---------- Sales Rollups ---------- */
+/* Revenue and qty per day (YYYYMMDD), per month (YYYYMM) and per product
+   per day. rollups.dat is a snapshot; each checkout appends its deltas and
+   a commit line to rollups.log, which is folded into the snapshot on load. */
+#define ROLLUP_MAGIC "DMROLUP"
+#define ROLLUP_VERSION 2
+
+enum { RU_DAY, RU_MONTH, RU_PRODUCT_DAY, ROLLUP_TABLES };
+
+typedef struct {
+    uint64_t key;   // 0 marks an empty slot
+    int64_t qty;
+    Money revenue;
+} RollupEntry;
+
+typedef struct {
+    RollupEntry *e;
+    int count, cap; // cap is a power of two, kept at least 2x count
+} RollupTable;
+
+typedef struct {
+    int loaded;
+    RollupTable t[ROLLUP_TABLES];
+    int64_t srcBytes;   // receipt log bytes the rollups account for
+} Rollups;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t count[ROLLUP_TABLES];
+    int64_t srcBytes;
+} RollupFileHeader;
+
+/* ---------- Receipt Index ---------- */
+/* receipts.idx locates every receipt in the receipt log by customer: a
+   header and one fixed-size entry per receipt, in receipt order. Entries
+   are appended with the receipt lines they describe, so the file only ever
+   trails the log; the gap is scanned on load. */
+#define RECEIPT_INDEX_MAGIC "DMRIDX"
+#define RECEIPT_INDEX_VERSION 1
+
+typedef struct {
+    uint64_t cust;      // customer_key() of the receipt's customer name
+    int64_t offset;     // log offset of its first line
+    int32_t rid, day;
+    uint32_t bytes, lines;
+} ReceiptIndexEntry;
+
+typedef struct {
+    char magic[8];
+    uint32_t version, recordSize;
+    int64_t srcBytes;   // receipt log scanned; entries may cover more
+} ReceiptIndexHeader;
+
+typedef struct {
+    int loaded;
+    ReceiptIndexEntry *e;
+    int32_t *prev;      // previous receipt of the same customer, or -1
+    int count, cap;
+    int32_t *head;      // open addressing: newest entry per customer, or -1
+    int customers, headCap;
+    int64_t srcBytes;   // receipt log bytes covered, queued checkouts included
+} ReceiptIndex;
+
+/* ---------- Group Commit ---------- */
+/* Checkout records are queued per target file and written by whichever
+   committing lane becomes leader, one write (and at most one fsync) per
+   file per batch. */
+enum { GC_RECEIPTS, GC_STOCK_JOURNAL, GC_ROLLUP_LOG, GC_RECEIPT_INDEX, GC_FILES };
+enum { DURABILITY_ASYNC, DURABILITY_WRITE, DURABILITY_FSYNC };
+
+typedef struct {
+    char *data;
+    size_t len, cap;
+} TextBuf;
+
+typedef struct {
+    int durability;     // DURABILITY_*: async returns before the write
+    int windowUs;       // leader waits this long for more checkouts to join
+    int maxBatch;       // ...unless this many are already queued
+} CommitConfig;
+
+typedef struct {
+    TextBuf pending[GC_FILES];
+    TextBuf spare[GC_FILES];
+    long long queued, written;  // checkout sequence numbers
+    int flushing;
+    double oldestAt;            // when the oldest unwritten checkout queued
+    int lastReceipt, storedReceipt; // receipt counter queued / persisted
+    long long checkouts, flushes, syncs, maxBatch;
+    double firstAt, lastAt;
+} GroupCommit;
+
+/* ---------- Bill Archive ---------- */
+/* Saved bills are appended to one bills/YYYYMMDD.bills file per day and
+   found by receipt id through bills/bills.idx, fixed-size entries in
+   receipt id order. */
+typedef struct {
+    int32_t rid, day;
+    int64_t offset;     // in that day's archive
+    uint32_t bytes, reserved;
+} BillIndexEntry;
+
+typedef struct {
+    int day;            // of the open archive
+    FILE *fp, *idx;
+    long long size;     // of the open archive
+    TextBuf text;       // bill being rendered
+} BillArchive;
+
+/* ---------- Instrumentation ---------- */
+/* Latency per checkout stage in log-linear buckets: exact below
+   HIST_SUB ns, then HIST_SUB buckets per power of two (~3% error). */
+enum { STAGE_CATALOG_LOAD, STAGE_CART_ADD, STAGE_PRINT_STEADY, STAGE_BILL_WRITE, STAGE_COMMIT_QUEUE, STAGE_COMMIT_WAIT,
+       STAGE_WRITE_RECEIPTS, STAGE_WRITE_STOCK_JOURNAL, STAGE_WRITE_ROLLUP_LOG,
+       STAGE_WRITE_RECEIPT_INDEX,   // GC_* order
+       STAGE_FSYNC, STAGE_STOCK_SAVE, STAGE_CHECKOUT, STAGES };
+enum { CTR_BYTES_RECEIPTS, CTR_BYTES_STOCK_JOURNAL, CTR_BYTES_ROLLUP_LOG,
+       CTR_BYTES_RECEIPT_INDEX,     // GC_* order
+       CTR_BYTES_BILLS, CTR_BYTES_CATALOG, CTR_FSYNCS, CTR_COMMIT_BATCHES, COUNTERS };
+
+#define HIST_SUB_BITS 5
+#define HIST_SUB (1 << HIST_SUB_BITS)
+#define HIST_MAX_BITS 42        // ~73 minutes in ns; longer samples land in the last bucket
+#define HIST_BUCKETS (HIST_SUB + (HIST_MAX_BITS - HIST_SUB_BITS) * HIST_SUB)
+#define STATS_DUMP_INTERVAL 10  // seconds between --stats-file rewrites
+
+typedef struct {
+    int counts[HIST_BUCKETS];
+    long long count, sum, max;  // ns
+} Histogram;
+
+typedef struct {
+    Histogram stage[STAGES];
+    long long counter[COUNTERS];
+    double since;
+} Stats;
+
+/* ---------- Resident Catalog ---------- */
+/* Loaded once per process and stored column-wise: the fields that billing
+   and stock checks read on every scan sit in dense parallel arrays, while
+   names live in a string arena addressed by offset and categories are
+   interned ids.
+   codeIndex is an open-addressing table of product indices keyed by
+   code (-1 marks an empty slot). */
+typedef struct {
+    int count;
+    int capacity;
+    int loaded;
+    /* hot fields */
+    int *code;
+    Money *price;
+    int *stock;
+    int *discount;      // percentage, in hundredths
+    int *reorder;       // reorder threshold
+    int *avail;         // stock minus open-cart reservations; atomic access only
+    /* cold fields */
+    uint32_t *nameOff;
+    int *categoryId;
+    int *subcategoryId;
+    StrDict categories, subcategories;
+    char *arena;
+    size_t arenaLen, arenaCap;
+    size_t arenaGarbage;    // bytes held by replaced or deleted strings
+    int *codeIndex;
+    int indexCap;   // power of two, kept at least 2x count
+    int backend;    // CATALOG_BACKEND_*
+    int journalLines;           // stock movements not yet checkpointed
+    unsigned char *dirty;
+    int *dirtyList;             // products changed since the last checkpoint
+    int dirtyCount;
+    /* binary backend: live view of products.bin for in-place record writes */
+    unsigned char *map;
+    size_t mapLen;
+#ifndef _WIN32
+    int mapFd;
+#endif
+} Catalog;
+
 /* ---------- Prototypes ---------- */
 /* general */
 void clear_console();
 void trimnewline(char *s);
 void strtolower(char *s);
 
+/* csv reader */
+int csv_open(CsvReader *r, const char *path);
+int csv_next(CsvReader *r, int maxFields);
+int csv_seek(CsvReader *r, long long off);
+int csv_read_at(CsvReader *r, long long off, size_t len);
+long long csv_tell(const CsvReader *r);
+void csv_close(CsvReader *r);
+int field_int(Field f, int *out);
+int field_int64(Field f, long long *out);
+int field_double(Field f, double *out);
+int field_cents(Field f, int64_t *out);
+int cents_parse(const char *s, int64_t *out);
+char* cents_str(char *buf, int64_t v);
+void field_copy(Field f, char *dst, size_t cap);
+int field_ieq(Field f, const char *s);
+int field_prefix(Field f, const char *s);
+
 /* product load/save */
-int load_products(Product products[], int maxProducts);
-int save_products(Product products[], int count);
-Product* find_product_by_code(Product products[], int count, int code);
+int load_products_file(const char *path, Catalog *c);
+int save_products_file(const char *path, const Catalog *c);
+int load_products_bin(const char *path, Catalog *c, uint32_t *version);
+int save_products_bin(const char *path, const Catalog *c);
+int catalog_import_csv(const char *csvPath, const char *binPath);
+int catalog_export_csv(const char *binPath, const char *csvPath);
+
+/* catalog storage */
+int catalog_push(Catalog *c, const Product *p);
+void catalog_product(const Catalog *c, int idx, Product *out);
+void catalog_set_strings(Catalog *c, int idx, const char *name, const char *category, const char *subcategory);
+void catalog_free(Catalog *c);
+int dict_find(const StrDict *d, const char *s);
+int dict_intern(StrDict *d, const char *s);
+const char* dict_str(const StrDict *d, int id);
+const char* catalog_name(const Catalog *c, int idx);
+const char* catalog_category(const Catalog *c, int idx);
+const char* catalog_subcategory(const Catalog *c, int idx);
+
+/* resident catalog */
+Catalog* catalog_get();
+int catalog_find(int code);
+int catalog_add(const Product *p);
+int catalog_update(int idx, const Product *p);
+int catalog_delete(int idx);
+int catalog_save();
+int catalog_write_record(int idx);
+void catalog_index_rebuild();
+
+/* stock journal */
+int catalog_apply_stock(int idx, int delta);
+int catalog_commit_reserved(int idx, int qty);
+int stock_reserve(int idx, int qty);
+void stock_release(int idx, int qty);
+int stock_available(int idx);
+int stock_journal_append(const int idx[], const int delta[], int n);
+int stock_journal_replay();
+int catalog_checkpoint();
+
+/* instrumentation */
+void stats_reset();
+void stats_print(FILE *fp);
+int stats_dump(const char *path);
+void stats_start_dumper();
+
+/* group commit */
+void group_commit_flush();
+void group_commit_report();
+void receipt_seq_store(int id);
+
+/* name search */
+void name_index_add(int idx);
+void name_index_remove(int idx);
+void name_index_rebuild();
+int name_index_search(const char *term, int out[], int max);
+
+/* category index */
+void category_index_add(int idx);
+void category_index_remove(int idx);
+void category_index_stock(int idx, int delta);
+void category_index_rebuild();
+
+/* low-stock watchlist */
+void low_stock_update(int idx);
+void low_stock_rebuild();
+int low_stock_list(int out[], int max);
+void low_stock_print_csv();
 
 /* admin */
 void admin_menu();
@@ -65,12 +576,52 @@ void admin_view_by_category();
 void admin_update_product();
 void admin_delete_product();
 void admin_low_stock_alerts();
+void admin_category_summary();
+void admin_stats();
 
 /* billing */
 void billing_menu();
 void billing_add_item_flow(Product products[], int prodCount);
-void billing_print_steady(CartItem cart[], int cartCount, const char *customerName);
-void billing_finalize_and_save(CartItem cart[], int cartCount, const char *customerName);
+void billing_print_steady(Lane *l);
+void billing_print_line(Lane *l, int code);
+void billing_finalize_and_save(Lane *lane);
+int bill_reprint(int rid);
+
+/* checkout lanes */
+int lane_add(Lane *l, int code, int qty);
+int lane_remove(Lane *l, int code);
+CartItem* lane_line(Lane *l, int code);
+void lane_cancel(Lane *l);
+void lane_free(Lane *l);
+Money lane_checkout(Lane *l, char *billPath, size_t billPathLen);
+int stress_lanes(int lanes, int checkouts, int persist);
+int batch_checkout(const char *path, int lanes, int writeBills);
+
+/* benchmarks */
+int gen_data(const char *dir, int skus, long long receiptLines, int customers);
+int run_benchmarks(const char *dir);
+
+/* columnar sales store */
+SalesStore* sales_store_get();
+const void* sales_column(int col);
+int sales_store_rebuild();
+
+/* sales rollups */
+Rollups* rollups_get();
+void rollups_record_checkout(CartItem cart[], int cartCount, int day, long long receiptBytes);
+int rollups_rebuild();
+
+/* receipt segments */
+ReceiptLog* receipt_log_get();
+long long receipt_log_size();
+void receipt_log_maybe_rotate(const char *incoming, size_t len);
+int receipt_log_last_id();
+int receipt_log_compact();
+
+/* receipt index */
+ReceiptIndex* receipt_index_get();
+void receipt_index_add(int rid, const char *customerName, const char *iso, size_t bytes, int lines);
+int receipt_index_rebuild();
 
 /* reports */
 void report_menu();
@@ -79,11 +630,16 @@ void report_daily_income();
 void report_monthly_income();
 void report_product_wise();
 void report_top_selling();
+void report_product_receipts();
+int sales_items_export(const char *path);
+Money income_total();
+Money income_days(int lo, int hi);
+Money income_month(int yyyymm);
+Money sales_revenue(int lo, int hi);
+int product_sales_by_day(int code, int lo, int hi, RollupEntry **out);
 
 /* receipts & helper */
-int next_receipt_id();
-void append_receipt_items(CartItem cart[], int cartCount, const char *customerName, const char *iso);
-void append_sales_items(CartItem cart[], int cartCount, const char *iso);
+size_t append_receipt_items(int rid, CartItem cart[], int cartCount, const char *customerName, const char *iso);
 void ensure_bills_dir();
 
 /* simple console helpers */
@@ -110,357 +666,2832 @@ void strtolower(char *s) {
     for (; *s; ++s) if (*s >= 'A' && *s <= 'Z') *s = *s - 'A' + 'a';
 }
 
-/* ---------- Products load/save ---------- */
-int load_products(Product products[], int maxProducts) {
-    FILE *fp = fopen(PRODUCTS_FILE, "r");
-    if (!fp) return 0;
-    char line[MAX_LINE];
-    int count = 0;
-    while (fgets(line, sizeof(line), fp) && count < maxProducts) {
-        trimnewline(line);
-        if (strlen(line) == 0) continue;
-        Product p;
-        memset(&p, 0, sizeof(p));
-        p.price = 0.0;
-        p.stock = 0;
-        p.discount = 0.0;
-        int fields = sscanf(line, "%d,%127[^,],%lf,%d,%lf,%63[^,],%63[^\n]",
-               &p.code, p.name, &p.price, &p.stock, &p.discount, p.category, p.subcategory);
-        if (fields >= 5) {
-            if (fields < 7) {
-                if (strlen(p.category) == 0) strcpy(p.category, "Uncategorized");
-                if (strlen(p.subcategory) == 0) strcpy(p.subcategory, "General");
-            }
-            products[count++] = p;
-        } else {
-            char *tok;
-            char tmp[MAX_LINE];
-            strncpy(tmp, line, sizeof(tmp)-1); tmp[sizeof(tmp)-1] = '\0';
-            tok = strtok(tmp, ",");
-            if (!tok) continue;
-            p.code = atoi(tok);
-            tok = strtok(NULL, ","); if (!tok) continue; strncpy(p.name, tok, sizeof(p.name));
-            tok = strtok(NULL, ","); if (tok) p.price = atof(tok);
-            tok = strtok(NULL, ","); if (tok) p.stock = atoi(tok);
-            tok = strtok(NULL, ","); if (tok) p.discount = atof(tok);
-            strncpy(p.category, "Uncategorized", sizeof(p.category));
-            strncpy(p.subcategory, "General", sizeof(p.subcategory));
-            products[count++] = p;
-        }
-    }
-    fclose(fp);
-    return count;
+static long long file_size(const char *path) {
+#ifdef _WIN32
+    struct _stati64 st;
+    if (_stati64(path, &st) != 0) return -1;
+#else
+    struct stat st;
+    if (stat(path, &st) != 0) return -1;
+#endif
+    return (long long)st.st_size;
+}
+
+static int make_dir(const char *path) {
+#ifdef _WIN32
+    return _mkdir(path) == 0 || errno == EEXIST;
+#else
+    return mkdir(path, 0755) == 0 || errno == EEXIST;
+#endif
+}
+
+static int file_seek(FILE *fp, long long off) {
+#ifdef _WIN32
+    return _fseeki64(fp, off, SEEK_SET) == 0;
+#else
+    return fseeko(fp, (off_t)off, SEEK_SET) == 0;
+#endif
+}
+
+static int file_truncate(const char *path, long long len) {
+#ifdef _WIN32
+    int fd = _open(path, _O_RDWR | _O_BINARY);
+    if (fd < 0) return 0;
+    int ok = _chsize_s(fd, len) == 0;
+    _close(fd);
+    return ok;
+#else
+    return truncate(path, (off_t)len) == 0;
+#endif
 }
 
-int save_products(Product products[], int count) {
-    FILE *fp = fopen(PRODUCTS_FILE, "w");
+/* Cuts path back to just after its last newline, so a line torn by a crash
+   mid-append cannot run into the next append. */
+static int file_drop_torn_tail(const char *path) {
+    long long size = file_size(path), keep = size;
+    if (size <= 0) return 1;
+    FILE *fp = fopen(path, "rb");
     if (!fp) return 0;
-    for (int i = 0; i < count; ++i) {
-        fprintf(fp, "%d,%s,%.2f,%d,%.2f,%s,%s\n",
-                products[i].code, products[i].name, products[i].price, products[i].stock,
-                products[i].discount, products[i].category, products[i].subcategory);
+    char buf[4096];
+    while (keep > 0) {
+        long long from = keep > (long long)sizeof(buf) ? keep - (long long)sizeof(buf) : 0;
+        size_t n = (size_t)(keep - from);
+        if (!file_seek(fp, from) || fread(buf, 1, n, fp) != n) { fclose(fp); return 0; }
+        while (n > 0 && buf[n-1] != '\n') n--;
+        keep = from + (long long)n;
+        if (n > 0) break;
     }
     fclose(fp);
+    return keep == size || file_truncate(path, keep);
+}
+
+/* ---------- Threads and atomics ---------- */
+
+#ifdef _WIN32
+typedef HANDLE thread_t;
+typedef SRWLOCK mutex_t;
+#define MUTEX_INIT SRWLOCK_INIT
+static void mutex_lock(mutex_t *m) { AcquireSRWLockExclusive(m); }
+static void mutex_unlock(mutex_t *m) { ReleaseSRWLockExclusive(m); }
+typedef struct { void *(*fn)(void *); void *arg; } ThreadStart;
+static DWORD WINAPI thread_trampoline(LPVOID p) {
+    ThreadStart ts = *(ThreadStart *)p;
+    free(p);
+    ts.fn(ts.arg);
+    return 0;
+}
+static int thread_start(thread_t *t, void *(*fn)(void *), void *arg) {
+    ThreadStart *ts = malloc(sizeof(*ts));
+    if (!ts) return 0;
+    ts->fn = fn; ts->arg = arg;
+    *t = CreateThread(NULL, 0, thread_trampoline, ts, 0, NULL);
+    if (!*t) { free(ts); return 0; }
     return 1;
 }
+static void thread_join(thread_t t) { WaitForSingleObject(t, INFINITE); CloseHandle(t); }
+typedef CONDITION_VARIABLE cond_t;
+#define COND_INIT CONDITION_VARIABLE_INIT
+static void cond_wait(cond_t *c, mutex_t *m) { SleepConditionVariableSRW(c, m, INFINITE, 0); }
+static void cond_broadcast(cond_t *c) { WakeAllConditionVariable(c); }
+static void sleep_us(int us) { Sleep((DWORD)((us + 999) / 1000)); }
+static double now_seconds() {
+    LARGE_INTEGER f, t;
+    QueryPerformanceFrequency(&f);
+    QueryPerformanceCounter(&t);
+    return (double)t.QuadPart / (double)f.QuadPart;
+}
+static long long now_ns() {
+    static LARGE_INTEGER f;
+    LARGE_INTEGER t;
+    if (!f.QuadPart) QueryPerformanceFrequency(&f);
+    QueryPerformanceCounter(&t);
+    return (long long)((double)t.QuadPart * 1e9 / (double)f.QuadPart);
+}
+#else
+typedef pthread_t thread_t;
+typedef pthread_mutex_t mutex_t;
+#define MUTEX_INIT PTHREAD_MUTEX_INITIALIZER
+static void mutex_lock(mutex_t *m) { pthread_mutex_lock(m); }
+static void mutex_unlock(mutex_t *m) { pthread_mutex_unlock(m); }
+static int thread_start(thread_t *t, void *(*fn)(void *), void *arg) { return pthread_create(t, NULL, fn, arg) == 0; }
+static void thread_join(thread_t t) { pthread_join(t, NULL); }
+typedef pthread_cond_t cond_t;
+#define COND_INIT PTHREAD_COND_INITIALIZER
+static void cond_wait(cond_t *c, mutex_t *m) { pthread_cond_wait(c, m); }
+static void cond_broadcast(cond_t *c) { pthread_cond_broadcast(c); }
+static void sleep_us(int us) { usleep((useconds_t)us); }
+static double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+static long long now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+#endif
 
-Product* find_product_by_code(Product products[], int count, int code) {
-    for (int i = 0; i < count; ++i) if (products[i].code == code) return &products[i];
-    return NULL;
+#if defined(_MSC_VER) && !defined(__clang__)
+static int atomic_load_int(int *p) { return (int)InterlockedCompareExchange((volatile long *)p, 0, 0); }
+static int atomic_add_int(int *p, int v) { return (int)InterlockedExchangeAdd((volatile long *)p, v) + v; }
+static int atomic_cas_int(int *p, int *expected, int desired) {
+    long seen = InterlockedCompareExchange((volatile long *)p, desired, *expected);
+    if (seen == *expected) return 1;
+    *expected = (int)seen;
+    return 0;
+}
+static void atomic_add_ll(long long *p, long long v) { InterlockedExchangeAdd64((volatile LONG64 *)p, v); }
+static void atomic_max_ll(long long *p, long long v) {
+    long long seen = *p;
+    while (v > seen) {
+        long long was = InterlockedCompareExchange64((volatile LONG64 *)p, v, seen);
+        if (was == seen) break;
+        seen = was;
+    }
 }
+#else
+static int atomic_load_int(int *p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+static int atomic_add_int(int *p, int v) { return __atomic_add_fetch(p, v, __ATOMIC_ACQ_REL); }
+/* On failure *expected is refreshed with the current value. */
+static int atomic_cas_int(int *p, int *expected, int desired) {
+    return __atomic_compare_exchange_n(p, expected, desired, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+static void atomic_add_ll(long long *p, long long v) { __atomic_add_fetch(p, v, __ATOMIC_RELAXED); }
+static void atomic_max_ll(long long *p, long long v) {
+    long long seen = __atomic_load_n(p, __ATOMIC_RELAXED);
+    while (v > seen && !__atomic_compare_exchange_n(p, &seen, v, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+}
+#endif
 
-/* ---------- Admin functions ---------- */
+/* Group commit state; see "Group commit" below. */
+static mutex_t g_commitLock = MUTEX_INIT;
+static cond_t g_commitDone = COND_INIT;
+static GroupCommit g_group;
+static CommitConfig g_commitConfig = { DURABILITY_WRITE, 0, 256 };
 
-void admin_menu() {
-    while (1) {
-        printf("\n==== STORE PERSON MENU ====\n");
-        printf("1. Add Product\n");
-        printf("2. View All Products\n");
-        printf("3. View Products by Category/Subcategory\n");
-        printf("4. Update Product\n");
-        printf("5. Delete Product\n");
-        printf("6. Low-stock Alerts (stock < 5)\n");
-        printf("7. Reports Menu\n");
-        printf("0. Back to Role Selection\n");
-        printf("Enter choice: ");
-        int ch;
-        if (scanf("%d", &ch) != 1) { while (getchar() != '\n'); ch = -1; }
-        while (getchar() != '\n');
-        if (ch == 0) return;
-        switch (ch) {
-            case 1: admin_add_product(); break;
-            case 2: admin_view_products(); break;
-            case 3: admin_view_by_category(); break;
-            case 4: admin_update_product(); break;
-            case 5: admin_delete_product(); break;
-            case 6: admin_low_stock_alerts(); break;
-            case 7: report_menu(); break;
-            default: printf("Invalid choice.\n");
-        }
-    }
+/* Instrumentation; see "Instrumentation" below. */
+static Stats g_stats;
+static const char *g_statsFile;     // --stats-file
+static int g_statsInterval = STATS_DUMP_INTERVAL;
+
+static void* xrealloc(void *ptr, size_t size) {
+    void *p = realloc(ptr, size);
+    if (!p && size) { printf("Out of memory.\n"); exit(1); }
+    return p;
 }
 
-void admin_add_product() {
-    Product products[MAX_PRODUCTS];
-    int n = load_products(products, MAX_PRODUCTS);
-    Product p;
-    printf("Enter product code (int): ");
-    if (scanf("%d", &p.code) != 1) { printf("Invalid.\n"); while(getchar()!='\n'); return; }
-    while(getchar()!='\n');
-    if (find_product_by_code(products, n, p.code)) { printf("Product code exists.\n"); return; }
-    printf("Enter product name: ");
-    fgets(p.name, sizeof(p.name), stdin); trimnewline(p.name);
-    printf("Enter price (e.g. 99.99): "); scanf("%lf", &p.price); while(getchar()!='\n');
-    printf("Enter stock (int): "); scanf("%d", &p.stock); while(getchar()!='\n');
-    printf("Enter discount percentage (e.g. 5.0): "); scanf("%lf", &p.discount); while(getchar()!='\n');
-    printf("Enter category: "); fgets(p.category, sizeof(p.category), stdin); trimnewline(p.category);
-    printf("Enter subcategory: "); fgets(p.subcategory, sizeof(p.subcategory), stdin); trimnewline(p.subcategory);
-    products[n++] = p;
-    if (!save_products(products, n)) printf("Failed to save products.\n");
-    else printf("Product added.\n");
+/* ---------- Instrumentation ---------- */
+/* Recording is lock-free (relaxed atomics), so lanes can time stages
+   concurrently; a report taken while lanes run may be off by the samples
+   in flight. */
+
+static int hist_bucket(long long v) {
+    if (v < HIST_SUB) return v < 0 ? 0 : (int)v;
+    int msb = 63;
+    while (!((unsigned long long)v >> msb)) msb--;
+    if (msb >= HIST_MAX_BITS) return HIST_BUCKETS - 1;
+    int shift = msb - HIST_SUB_BITS;
+    return HIST_SUB + shift * HIST_SUB + (int)((v >> shift) - HIST_SUB);
 }
 
-void admin_view_products() {
-    Product products[MAX_PRODUCTS];
-    int n = load_products(products, MAX_PRODUCTS);
-    if (n == 0) { printf("No products found.\n"); return; }
-    printf("\nCode | Name | Price | Stock | Disc | Category > Sub\n");
-    printf("--------------------------------------------------------------\n");
-    for (int i = 0; i < n; ++i) {
-        printf("%4d | % -25s | %7.2f | %5d | %4.1f%% | %s > %s\n",
-               products[i].code, products[i].name, products[i].price, products[i].stock,
-               products[i].discount, products[i].category, products[i].subcategory);
-    }
-    printf("Total products: %d\n", n);
-    printf("+------+---------------------------+---------+-------+--------+-------------------+-------------------+\n");
-    printf("| Code | Name                      | Price   | Stock | Disc%%  | Category          | Subcategory        |\n");
-    printf("+------+---------------------------+---------+-------+--------+-------------------+-------------------+\n");
-    for (int i = 0; i < n; ++i) {
-        printf("| %-4d | %-25s | %7.2f | %5d | %5.1f | %-17s | %-17s |\n",
-               products[i].code, products[i].name, products[i].price, products[i].stock,
-               products[i].discount, products[i].category, products[i].subcategory);
-    }
-    printf("+------+---------------------------+---------+-------+--------+-------------------+-------------------+\n");
+/* Midpoint of a bucket's value range. */
+static long long hist_bucket_value(int b) {
+    if (b < HIST_SUB) return b;
+    int shift = (b - HIST_SUB) / HIST_SUB;
+    long long lo = (long long)(HIST_SUB + (b - HIST_SUB) % HIST_SUB) << shift;
+    return lo + ((1LL << shift) >> 1);
 }
 
-void admin_view_by_category() {
-    Product products[MAX_PRODUCTS];
-    int n = load_products(products, MAX_PRODUCTS);
-    if (n == 0) { printf("No products.\n"); return; }
-    printf("Enter category (or 'all'): ");
-    char cat[64]; fgets(cat, sizeof(cat), stdin); trimnewline(cat);
-    printf("Enter subcategory (or 'all'): ");
-    char sub[64]; fgets(sub, sizeof(sub), stdin); trimnewline(sub);
-    int cnt = 0;
-    printf("+------+---------------------------+---------+-------+--------+-------------------+-------------------+\n");
-    printf("| Code | Name                      | Price   | Stock | Disc%%  | Category          | Subcategory        |\n");
-    printf("+------+---------------------------+---------+-------+--------+-------------------+-------------------+\n");
-    for (int i = 0; i < n; ++i) {
-        int mc = (strcmp(cat, "all")==0 || strlen(cat)==0) ? 1 : (strcmp(products[i].category, cat)==0);
-        int ms = (strcmp(sub, "all")==0 || strlen(sub)==0) ? 1 : (strcmp(products[i].subcategory, sub)==0);
-        if (mc && ms) {
-            printf("| %-4d | %-25s | %7.2f | %5d | %5.1f | %-17s | %-17s |\n",
-                   products[i].code, products[i].name, products[i].price, products[i].stock,
-                   products[i].discount, products[i].category, products[i].subcategory);
-            cnt++;
-        }
+static void hist_record(Histogram *h, long long ns) {
+    atomic_add_int(&h->counts[hist_bucket(ns)], 1);
+    atomic_add_ll(&h->count, 1);
+    atomic_add_ll(&h->sum, ns);
+    atomic_max_ll(&h->max, ns);
+}
+
+/* Value below which fraction q of the samples fall. */
+static long long hist_quantile(const Histogram *h, double q) {
+    long long total = 0, seen = 0;
+    for (int b = 0; b < HIST_BUCKETS; ++b) total += h->counts[b];
+    if (total == 0) return 0;
+    long long rank = (long long)(q * total + 0.5);
+    if (rank < 1) rank = 1;
+    for (int b = 0; b < HIST_BUCKETS; ++b) {
+        seen += h->counts[b];
+        if (seen >= rank) return hist_bucket_value(b) < h->max ? hist_bucket_value(b) : h->max;
     }
-    printf("+------+---------------------------+---------+-------+--------+-------------------+-------------------+\n");
-    if (cnt == 0) printf("No matching products.\n");
+    return h->max;
 }
 
-void admin_update_product() {
-    Product products[MAX_PRODUCTS];
-    int n = load_products(products, MAX_PRODUCTS);
-    if (n == 0) { printf("No products.\n"); return; }
-    int code; printf("Enter product code to update: "); if (scanf("%d", &code) != 1) { while(getchar()!='\n'); printf("Invalid.\n"); return; }
-    while(getchar()!='\n');
-    int idx = -1;
-    for (int i = 0; i < n; ++i) if (products[i].code == code) { idx = i; break; }
-    if (idx == -1) { printf("Not found.\n"); return; }
-    Product *p = &products[idx];
-    printf("Updating %d: %s\n", p->code, p->name);
-    printf("New name (blank to keep): "); char tmp[128]; fgets(tmp, sizeof(tmp), stdin); trimnewline(tmp); if (strlen(tmp)) strncpy(p->name, tmp, sizeof(p->name));
-    printf("New price (-1 to keep %.2f): ", p->price); double d; if (scanf("%lf", &d)==1) { if (d >= 0) p->price = d; } while(getchar()!='\n');
-    printf("New stock (-1 to keep %d): ", p->stock); int si; if (scanf("%d", &si)==1) { if (si >= 0) p->stock = si; } while(getchar()!='\n');
-    printf("New discount (-1 to keep %.2f): ", p->discount); if (scanf("%lf", &d)==1) { if (d >= 0) p->discount = d; } while(getchar()!='\n');
-    printf("New category (blank to keep %s): ", p->category); fgets(tmp, sizeof(tmp), stdin); trimnewline(tmp); if (strlen(tmp)) strncpy(p->category, tmp, sizeof(p->category));
-    printf("New subcategory (blank to keep %s): ", p->subcategory); fgets(tmp, sizeof(tmp), stdin); trimnewline(tmp); if (strlen(tmp)) strncpy(p->subcategory, tmp, sizeof(p->subcategory));
-    if (!save_products(products, n)) printf("Save failed.\n"); else printf("Product updated.\n");
+/* Records the time since start (from now_ns()) against stage. */
+static void stats_time(int stage, long long start) {
+    hist_record(&g_stats.stage[stage], now_ns() - start);
 }
 
-void admin_delete_product() {
-    Product products[MAX_PRODUCTS];
-    int n = load_products(products, MAX_PRODUCTS);
-    if (n == 0) { printf("No products.\n"); return; }
-    int code; printf("Enter product code to delete: "); if (scanf("%d", &code) != 1) { while(getchar()!='\n'); printf("Invalid.\n"); return; }
-    while(getchar()!='\n');
-    int idx = -1;
-    for (int i = 0; i < n; ++i) if (products[i].code == code) { idx = i; break; }
-    if (idx == -1) { printf("Not found.\n"); return; }
-    for (int i = idx; i < n-1; ++i) products[i] = products[i+1];
-    n--;
-    if (!save_products(products, n)) printf("Failed to save.\n"); else printf("Deleted.\n");
+static void stats_count(int counter, long long n) {
+    atomic_add_ll(&g_stats.counter[counter], n);
 }
 
-void admin_low_stock_alerts() {
-    Product products[MAX_PRODUCTS];
-    int n = load_products(products, MAX_PRODUCTS);
-    int found = 0;
-    printf("\nLow-stock products (stock < 5):\n");
-    for (int i = 0; i < n; ++i) {
-        if (products[i].stock < 5) {
-            printf("%4d | % -20s | stock: %d\n", products[i].code, products[i].name, products[i].stock);
-            found++;
-        }
-    }
-    if (!found) printf("No low-stock products.\n");
+void stats_reset() {
+    memset(&g_stats, 0, sizeof(g_stats));
+    g_stats.since = now_seconds();
 }
 
-/* ---------- Billing functions (cashier) ---------- */
+void stats_print(FILE *fp) {
+    static const char *const stage[STAGES] = { "catalog load", "cart add", "print steady bill", "bill file write",
+        "commit queue", "commit wait", "write receipts", "write stock journal",
+        "write rollup log", "write receipt index", "fsync", "stock save", "checkout total" };
+    static const char *const counter[COUNTERS] = { "receipts bytes", "stock journal bytes",
+        "rollup log bytes", "receipt index bytes", "bill bytes", "catalog bytes", "fsyncs", "commit batches" };
+    fprintf(fp, "Latency per stage in microseconds (%.0fs of samples)\n", g_stats.since ? now_seconds() - g_stats.since : 0.0);
+    fprintf(fp, "%-20s %10s %10s %10s %10s %10s %10s\n", "stage", "count", "mean", "p50", "p99", "p99.9", "max");
+    for (int i = 0; i < STAGES; ++i) {
+        const Histogram *h = &g_stats.stage[i];
+        if (h->count == 0) continue;
+        fprintf(fp, "%-20s %10lld %10.1f %10.1f %10.1f %10.1f %10.1f\n", stage[i], h->count, h->sum / 1e3 / h->count,
+                hist_quantile(h, 0.5) / 1e3, hist_quantile(h, 0.99) / 1e3, hist_quantile(h, 0.999) / 1e3, h->max / 1e3);
+    }
+    for (int i = 0; i < COUNTERS; ++i) fprintf(fp, "%-20s %10lld\n", counter[i], g_stats.counter[i]);
+}
 
-void ensure_bills_dir() {
-#ifdef _WIN32
-    CreateDirectoryA(BILLS_DIR, NULL);
-#else
-    char cmd[256];
-    snprintf(cmd, sizeof(cmd), "mkdir -p %s 2>/dev/null", BILLS_DIR);
-    system(cmd);
-#endif
+/* Rewrites path with the current report, via path.tmp. */
+int stats_dump(const char *path) {
+    char tmp[512];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *fp = fopen(tmp, "w");
+    if (!fp) return 0;
+    time_t t = time(NULL);
+    char iso[32]; strftime(iso, sizeof(iso), "%Y-%m-%d %H:%M:%S", localtime(&t));
+    fprintf(fp, "Stats at %s\n", iso);
+    stats_print(fp);
+    if (fclose(fp) != 0) { remove(tmp); return 0; }
+    remove(path);   // rename() does not replace on Windows
+    return rename(tmp, path) == 0;
 }
 
-int next_receipt_id() {
-    FILE *fp = fopen(RECEIPTS_FILE, "r");
-    if (!fp) return 1;
-    int last = 0;
-    char line[MAX_LINE];
-    while (fgets(line, sizeof(line), fp)) {
-        trimnewline(line);
-        if (strlen(line) == 0) continue;
-        int id = 0;
-        if (sscanf(line, "%d,", &id) == 1) {
-            if (id > last) last = id;
-        }
-    }
-    fclose(fp);
-    return last + 1;
+static void stats_dump_at_exit() {
+    if (g_statsFile) stats_dump(g_statsFile);
 }
 
-void append_receipt_items(CartItem cart[], int cartCount, const char *customerName, const char *iso) {
-    FILE *fp = fopen(RECEIPTS_FILE, "a");
-    if (!fp) { printf("Warning: cannot append to %s\n", RECEIPTS_FILE); return; }
-    int rid = next_receipt_id();
-    for (int i = 0; i < cartCount; ++i) {
-        fprintf(fp, "%d,%s,%s,%d,%s,%d,%.2f,%.2f\n",
-                rid, customerName, iso, cart[i].code, cart[i].name, cart[i].qty, cart[i].priceAfterDisc, cart[i].total);
+static void* stats_dump_run(void *arg) {
+    (void)arg;
+    for (;;) {
+        for (int i = 0; i < g_statsInterval; ++i) sleep_us(1000000);
+        if (!stats_dump(g_statsFile)) printf("Warning: cannot write %s\n", g_statsFile);
     }
-    fclose(fp);
+    return NULL;
 }
 
-void append_sales_items(CartItem cart[], int cartCount, const char *iso) {
-    FILE *fp = fopen(SALES_ITEMS_FILE, "a");
-    if (!fp) { printf("Warning: cannot append to %s\n", SALES_ITEMS_FILE); return; }
-    for (int i = 0; i < cartCount; ++i) {
-        fprintf(fp, "%d,%s,%d,%.2f,%.2f,%s\n",
-                cart[i].code, cart[i].name, cart[i].qty, cart[i].priceAfterDisc, cart[i].total, iso);
-    }
-    fclose(fp);
+/* Starts the periodic --stats-file writer; it runs until exit. */
+void stats_start_dumper() {
+    thread_t t;
+    atexit(stats_dump_at_exit);
+    if (!thread_start(&t, stats_dump_run, NULL)) printf("Warning: cannot start the stats writer.\n");
 }
 
-void billing_print_steady(CartItem cart[], int cartCount, const char *customerName) {
-    time_t t = time(NULL);
-    struct tm *lt = localtime(&t);
-    char iso[32]; strftime(iso, sizeof(iso), "%Y-%m-%d %H:%M:%S", lt);
+/* ---------- CSV reader ---------- */
+
+static unsigned first_bit(unsigned m) {
+#if defined(_MSC_VER)
+    unsigned long i; _BitScanForward(&i, m); return (unsigned)i;
+#else
+    return (unsigned)__builtin_ctz(m);
+#endif
+}
+
+/* First byte equal to a or b in [p, end), or end. */
+static const char* scan_bytes(const char *p, const char *end, char a, char b) {
+#if defined(__AVX2__)
+    const __m256i va = _mm256_set1_epi8(a), vb = _mm256_set1_epi8(b);
+    for (; end - p >= 32; p += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        unsigned m = (unsigned)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, va), _mm256_cmpeq_epi8(v, vb)));
+        if (m) return p + first_bit(m);
+    }
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+    const __m128i sa = _mm_set1_epi8(a), sb = _mm_set1_epi8(b);
+    for (; end - p >= 16; p += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        unsigned m = (unsigned)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, sa), _mm_cmpeq_epi8(v, sb)));
+        if (m) return p + first_bit(m);
+    }
+#endif
+    for (; p < end; ++p) if (*p == a || *p == b) return p;
+    return end;
+}
+
+/* "-" reads standard input. */
+int csv_open(CsvReader *r, const char *path) {
+    memset(r, 0, sizeof(*r));
+    r->fp = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+    if (!r->fp) return 0;
+    r->cap = CSV_BLOCK;
+    r->buf = xrealloc(NULL, r->cap);
+    return 1;
+}
+
+int csv_seek(CsvReader *r, long long off) {
+    r->pos = r->len = 0;
+    r->eof = 0;
+    r->base = off;
+#ifdef _WIN32
+    return _fseeki64(r->fp, off, SEEK_SET) == 0;
+#else
+    return fseeko(r->fp, (off_t)off, SEEK_SET) == 0;
+#endif
+}
+
+/* Loads exactly [off, off + len), so the following csv_next() calls stop
+   at its end instead of reading ahead a whole block. */
+int csv_read_at(CsvReader *r, long long off, size_t len) {
+    if (!csv_seek(r, off)) return 0;
+    if (len > r->cap) { r->cap = len; r->buf = xrealloc(r->buf, r->cap); }
+    r->len = fread(r->buf, 1, len, r->fp);
+    r->eof = 1;
+    return r->len == len;
+}
+
+/* File offset of the first byte not yet returned by csv_next(). */
+long long csv_tell(const CsvReader *r) {
+    return r->base + (long long)r->pos;
+}
+
+void csv_close(CsvReader *r) {
+    if (r->fp && r->fp != stdin) fclose(r->fp);
+    free(r->buf);
+    memset(r, 0, sizeof(*r));
+}
+
+/* Splits the next non-blank record into r->f and returns the field count,
+   or 0 at end of file. The last of maxFields fields takes the rest of the
+   line, commas included. */
+int csv_next(CsvReader *r, int maxFields) {
+    if (maxFields > CSV_MAX_FIELDS) maxFields = CSV_MAX_FIELDS;
+    size_t scanned = r->pos;
+    while (1) {
+        const char *s = r->buf + r->pos, *e = r->buf + r->len;
+        const char *nl = scan_bytes(r->buf + scanned, e, '\n', '\n');
+        if (nl == e && !r->eof) {
+            size_t pending = r->len - r->pos;
+            r->base += (long long)r->pos;
+            memmove(r->buf, s, pending);
+            r->pos = 0; r->len = pending; scanned = pending;
+            if (r->len == r->cap) { r->cap *= 2; r->buf = xrealloc(r->buf, r->cap); }
+            size_t got = fread(r->buf + r->len, 1, r->cap - r->len, r->fp);
+            if (got == 0) r->eof = 1;
+            r->len += got;
+            continue;
+        }
+        if (s == e) return 0;
+        r->torn = nl == e;
+        r->pos = (size_t)(nl - r->buf) + (nl < e);
+        scanned = r->pos;
+        const char *le = nl;
+        if (le > s && le[-1] == '\r') le--;
+        if (le == s) continue;
+        r->nf = 0;
+        for (const char *p = s;; ) {
+            const char *q = r->nf == maxFields - 1 ? le : scan_bytes(p, le, ',', ',');
+            r->f[r->nf].p = p;
+            r->f[r->nf].len = (int)(q - p);
+            r->nf++;
+            if (q == le) break;
+            p = q + 1;
+        }
+        return r->nf;
+    }
+}
+
+static const char* field_skip_space(const char *p, const char *e) {
+    while (p < e && (*p == ' ' || *p == '\t')) p++;
+    return p;
+}
+
+int field_int64(Field f, long long *out) {
+    const char *p = field_skip_space(f.p, f.p + f.len), *e = f.p + f.len;
+    int neg = 0;
+    if (p < e && (*p == '-' || *p == '+')) neg = *p++ == '-';
+    if (p == e || *p < '0' || *p > '9') return 0;
+    long long v = 0;
+    for (; p < e && *p >= '0' && *p <= '9'; ++p) {
+        if (v > (LLONG_MAX - 9) / 10) return 0;
+        v = v * 10 + (*p - '0');
+    }
+    if (field_skip_space(p, e) != e) return 0;
+    *out = neg ? -v : v;
+    return 1;
+}
+
+int field_int(Field f, int *out) {
+    long long v;
+    if (!field_int64(f, &v) || v > INT_MAX || v < INT_MIN) return 0;
+    *out = (int)v;
+    return 1;
+}
+
+/* Plain decimals up to 15 significant digits are converted exactly from an
+   integer mantissa; anything else (exponents, long digit runs) goes through
+   strtod. */
+int field_double(Field f, double *out) {
+    static const double pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+                                    1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15 };
+    const char *p = field_skip_space(f.p, f.p + f.len), *e = f.p + f.len;
+    int neg = 0;
+    if (p < e && (*p == '-' || *p == '+')) neg = *p++ == '-';
+    uint64_t m = 0;
+    int digits = 0, frac = 0, fast = 1;
+    for (; p < e && *p >= '0' && *p <= '9'; ++p, ++digits) m = m * 10 + (uint64_t)(*p - '0');
+    if (p < e && *p == '.') {
+        for (++p; p < e && *p >= '0' && *p <= '9'; ++p, ++digits, ++frac) m = m * 10 + (uint64_t)(*p - '0');
+    }
+    if (digits == 0 || digits > 15 || field_skip_space(p, e) != e) fast = 0;
+    if (fast) {
+        double v = (double)m / pow10[frac];
+        *out = neg ? -v : v;
+        return 1;
+    }
+    char tmp[64], *end;
+    if (f.len <= 0 || f.len >= (int)sizeof(tmp)) return 0;
+    memcpy(tmp, f.p, f.len); tmp[f.len] = '\0';
+    double v = strtod(tmp, &end);
+    if (end == tmp) return 0;
+    *out = v;
+    return 1;
+}
+
+/* Two-decimal fixed point: "12.345" -> 1235, halves rounding away from
+   zero. Forms the plain parse does not take (exponents, more than 15
+   integer digits) are rounded from a double. */
+int field_cents(Field f, int64_t *out) {
+    const char *p = field_skip_space(f.p, f.p + f.len), *e = f.p + f.len;
+    int neg = 0;
+    if (p < e && (*p == '-' || *p == '+')) neg = *p++ == '-';
+    int64_t v = 0;
+    int digits = 0, frac = 0;
+    for (; p < e && *p >= '0' && *p <= '9'; ++p, ++digits) if (digits < 16) v = v * 10 + (*p - '0');
+    v *= 100;
+    if (p < e && *p == '.') {
+        for (++p; p < e && *p >= '0' && *p <= '9'; ++p, ++frac) {
+            if (frac == 0) v += (*p - '0') * 10;
+            else if (frac == 1) v += *p - '0';
+            else if (frac == 2) v += *p >= '5';
+        }
+    }
+    if ((digits || frac) && digits <= 15 && field_skip_space(p, e) == e) {
+        *out = neg ? -v : v;
+        return 1;
+    }
+    double d;
+    if (!field_double(f, &d) || !(d > -9e16 && d < 9e16)) return 0;
+    *out = (int64_t)(d * 100 + (d < 0 ? -0.5 : 0.5));
+    return 1;
+}
+
+int cents_parse(const char *s, int64_t *out) {
+    Field f = { s, (int)strlen(s) };
+    return field_cents(f, out);
+}
+
+/* Formats a two-decimal fixed-point value as "[-]123.45" into buf, which
+   holds CENTS_CHARS bytes. */
+char* cents_str(char *buf, int64_t v) {
+    uint64_t a = v < 0 ? 0 - (uint64_t)v : (uint64_t)v;
+    snprintf(buf, CENTS_CHARS, "%s%llu.%02u", v < 0 ? "-" : "", (unsigned long long)(a / 100), (unsigned)(a % 100));
+    return buf;
+}
+
+/* Copies the field as a C string, truncating to fit cap. */
+void field_copy(Field f, char *dst, size_t cap) {
+    size_t n = (size_t)f.len < cap - 1 ? (size_t)f.len : cap - 1;
+    memcpy(dst, f.p, n);
+    dst[n] = '\0';
+}
+
+int field_ieq(Field f, const char *s) {
+    int i = 0;
+    for (; i < f.len && s[i]; ++i)
+        if (tolower((unsigned char)f.p[i]) != tolower((unsigned char)s[i])) return 0;
+    return i == f.len && s[i] == '\0';
+}
+
+int field_prefix(Field f, const char *s) {
+    size_t n = strlen(s);
+    return (size_t)f.len >= n && memcmp(f.p, s, n) == 0;
+}
+
+/* ---------- Parallel scan ---------- */
+/* Splits a range of line-oriented files, read as one log, into
+   newline-aligned chunks that worker threads claim in turn; no chunk
+   spans two files. A kernel leaves each chunk's partial result in a
+   per-chunk slot of its argument, and merge folds the slots in file
+   order, one at a time, as soon as all earlier chunks are in. Workers
+   stay at most SCAN_AHEAD chunks per thread ahead of the merge, which
+   bounds the partial results held at once. */
+
+static int g_scanThreads;   // 0: one per CPU
+
+typedef struct {
+    char path[64];
+    long long base, size;   // log offset of its first byte; its length
+} ScanFile;
+
+typedef struct {
+    ScanFile *file;
+    int files;
+    long long *start, *end; // chunk c is [start[c], end[c]) of the log, in file[fileOf[c]]
+    int *fileOf;
+    int chunks, cap, threads;
+    long long stop;         // end of the last whole line in range
+    int next, merged;       // next chunk to claim / to merge
+    unsigned char *done;
+    mutex_t lock;
+    cond_t progress;
+    int (*kernel)(CsvReader *r, long long end, int chunk, void *arg);
+    int (*merge)(int chunk, int ok, void *arg);    // ok 0 after a failure: only free the chunk
+    void *arg;
+    int ok;
+} ParallelScan;
+
+static int scan_cpus() {
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return (int)si.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+/* First line start at or after off (> 0), or to if there is none before it. */
+static long long scan_line_start(FILE *fp, long long off, long long to) {
+    char buf[4096];
+    for (long long at = off - 1; at < to && file_seek(fp, at); ) {  // a newline right before off makes it a start
+        size_t n = fread(buf, 1, sizeof(buf), fp);
+        if (n == 0) break;
+        const char *nl = memchr(buf, '\n', n);
+        if (nl) return at + (nl - buf) + 1 < to ? at + (nl - buf) + 1 : to;
+        at += (long long)n;
+    }
+    return to;
+}
+
+/* End of the last whole line in [from, to) of fp, or from if there is none. */
+static long long scan_line_end(FILE *fp, long long from, long long to) {
+    char buf[4096];
+    while (to > from) {
+        long long at = to - (long long)sizeof(buf) > from ? to - (long long)sizeof(buf) : from;
+        size_t n = (size_t)(to - at), i = n;
+        if (!file_seek(fp, at) || fread(buf, 1, n, fp) != n) return from;
+        while (i > 0 && buf[i - 1] != '\n') i--;
+        if (i > 0) return at + (long long)i;
+        to = at;
+    }
+    return from;
+}
+
+static void scan_free(ParallelScan *s) {
+    free(s->start); free(s->end); free(s->fileOf); free(s->file);
+    s->start = s->end = NULL;
+    s->fileOf = NULL;
+    s->file = NULL;
+    s->chunks = s->cap = 0;
+}
+
+/* Splits [from, to) of the log made of files into chunks of about
+   SCAN_CHUNK bytes. to is pulled back to the end of the last whole line,
+   so a line still being appended is left for next time; stop is where
+   the scan ends. */
+static int scan_split(ParallelScan *s, const ScanFile *files, int nfiles, long long from, long long to) {
+    memset(s, 0, sizeof(*s));
+    s->file = xrealloc(NULL, sizeof(ScanFile) * (nfiles ? nfiles : 1));
+    memcpy(s->file, files, sizeof(ScanFile) * nfiles);
+    s->files = nfiles;
+    s->stop = from;
+    for (int f = 0; f < nfiles; ++f) {
+        long long lo = files[f].base > from ? files[f].base : from;
+        long long hi = files[f].base + files[f].size < to ? files[f].base + files[f].size : to;
+        if (lo >= hi) continue;
+        FILE *fp = NULL;  // only needed to find line boundaries
+        if ((hi == to || hi - lo > SCAN_CHUNK) && (fp = fopen(files[f].path, "rb")) == NULL) { scan_free(s); return 0; }
+        if (hi == to) hi = files[f].base + scan_line_end(fp, lo - files[f].base, hi - files[f].base);
+        long long bytes = hi - lo, base = files[f].base;
+        int n = bytes > SCAN_CHUNK ? (int)((bytes + SCAN_CHUNK - 1) / SCAN_CHUNK) : 1;
+        for (int c = 0; c < n; ++c) {
+            long long e = c == n - 1 ? hi : base + scan_line_start(fp, lo - base + bytes / n * (c + 1), hi - base);
+            long long b = c == 0 ? lo : s->end[s->chunks - 1];
+            if (e <= b) continue;
+            if (s->chunks == s->cap) {
+                s->cap = s->cap ? s->cap * 2 : 16;
+                s->start = xrealloc(s->start, sizeof(long long) * s->cap);
+                s->end = xrealloc(s->end, sizeof(long long) * s->cap);
+                s->fileOf = xrealloc(s->fileOf, sizeof(int) * s->cap);
+            }
+            s->start[s->chunks] = b;
+            s->end[s->chunks] = e;
+            s->fileOf[s->chunks++] = f;
+        }
+        if (fp) fclose(fp);
+        s->stop = hi;
+    }
+    s->threads = g_scanThreads > 0 ? g_scanThreads : scan_cpus();
+    if (s->threads > s->chunks) s->threads = s->chunks;
+    if (s->threads < 1) s->threads = 1;
+    return 1;
+}
+
+static void* scan_worker(void *arg) {
+    ParallelScan *s = arg;
+    CsvReader r;
+    int open = -1;  // file r reads, -1 for none
+    mutex_lock(&s->lock);
+    while (s->next < s->chunks) {
+        int c = s->next;
+        if (c - s->merged >= s->threads * SCAN_AHEAD) { cond_wait(&s->progress, &s->lock); continue; }
+        s->next++;
+        int ok = s->ok, f = s->fileOf[c];
+        mutex_unlock(&s->lock);
+        if (ok && open != f) {
+            if (open >= 0) csv_close(&r);
+            open = csv_open(&r, s->file[f].path) ? f : -1;
+            ok = open >= 0;
+        }
+        if (ok) {
+            ok = csv_seek(&r, s->start[c] - s->file[f].base);
+            r.base = s->start[c];   // kernels see log offsets
+            ok = ok && s->kernel(&r, s->end[c], c, s->arg);
+        }
+        mutex_lock(&s->lock);
+        if (!ok) s->ok = 0;
+        s->done[c] = 1;
+        for (; s->merged < s->chunks && s->done[s->merged]; s->merged++)
+            if (!s->merge(s->merged, s->ok, s->arg)) s->ok = 0;
+        cond_broadcast(&s->progress);
+    }
+    mutex_unlock(&s->lock);
+    if (open >= 0) csv_close(&r);
+    return NULL;
+}
+
+/* Runs the scan on s->threads threads, the calling one included. Returns
+   0 if a read, kernel or merge failed. */
+static int scan_run(ParallelScan *s, int (*kernel)(CsvReader *r, long long end, int chunk, void *arg),
+                    int (*merge)(int chunk, int ok, void *arg), void *arg) {
+    static const mutex_t unlocked = MUTEX_INIT;
+    static const cond_t idle = COND_INIT;
+    s->lock = unlocked;
+    s->progress = idle;
+    s->kernel = kernel; s->merge = merge; s->arg = arg;
+    s->next = s->merged = 0;
+    s->ok = 1;
+    s->done = xrealloc(NULL, (size_t)s->chunks + 1);
+    memset(s->done, 0, (size_t)s->chunks + 1);
+    thread_t *th = xrealloc(NULL, sizeof(thread_t) * s->threads);
+    int started = 0;
+    for (int i = 1; i < s->threads; ++i) if (thread_start(&th[started], scan_worker, s)) started++;
+    scan_worker(s);
+    for (int i = 0; i < started; ++i) thread_join(th[i]);
+    free(th);
+    free(s->done);
+    return s->ok;
+}
+
+/* ---------- Catalog storage ---------- */
+
+/* Lower bound of id in a sorted list. */
+static int idlist_find(const IdList *l, int id) {
+    int lo = 0, hi = l->count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (l->ids[mid] < id) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+static void idlist_insert(IdList *l, int id) {
+    int at = l->count;
+    if (l->count > 0 && l->ids[l->count-1] >= id) {
+        at = idlist_find(l, id);
+        if (at < l->count && l->ids[at] == id) return;
+    }
+    if (l->count == l->cap) { l->cap = l->cap ? l->cap * 2 : 4; l->ids = xrealloc(l->ids, sizeof(int) * l->cap); }
+    memmove(&l->ids[at+1], &l->ids[at], sizeof(int) * (l->count - at));
+    l->ids[at] = id;
+    l->count++;
+}
+
+static void idlist_erase(IdList *l, int id) {
+    int at = idlist_find(l, id);
+    if (at >= l->count || l->ids[at] != id) return;
+    memmove(&l->ids[at], &l->ids[at+1], sizeof(int) * (l->count - at - 1));
+    l->count--;
+}
+
+static unsigned str_hash(const char *s) {
+    unsigned h = 2166136261u;
+    for (; *s; ++s) h = (h ^ (unsigned char)*s) * 16777619u;
+    return h;
+}
+
+const char* dict_str(const StrDict *d, int id) { return d->arena + d->off[id]; }
+
+/* Returns the id of s, or -1 if it has never been interned. */
+int dict_find(const StrDict *d, const char *s) {
+    if (d->slotCap == 0) return -1;
+    unsigned mask = (unsigned)d->slotCap - 1;
+    unsigned h = str_hash(s) & mask;
+    int id;
+    while ((id = d->slots[h]) != -1) {
+        if (strcmp(dict_str(d, id), s) == 0) return id;
+        h = (h + 1) & mask;
+    }
+    return -1;
+}
+
+int dict_intern(StrDict *d, const char *s) {
+    int id = dict_find(d, s);
+    if (id >= 0) return id;
+    if ((d->count + 1) * 2 > d->slotCap) {
+        d->slotCap = d->slotCap ? d->slotCap * 2 : 64;
+        d->slots = xrealloc(d->slots, sizeof(int) * d->slotCap);
+        for (int i = 0; i < d->slotCap; ++i) d->slots[i] = -1;
+        unsigned mask = (unsigned)d->slotCap - 1;
+        for (int i = 0; i < d->count; ++i) {
+            unsigned h = str_hash(dict_str(d, i)) & mask;
+            while (d->slots[h] != -1) h = (h + 1) & mask;
+            d->slots[h] = i;
+        }
+    }
+    size_t len = strlen(s) + 1;
+    if (d->len + len > d->cap) {
+        while (d->len + len > d->cap) d->cap = d->cap ? d->cap * 2 : 1024;
+        d->arena = xrealloc(d->arena, d->cap);
+    }
+    if (d->count == d->offCap) { d->offCap = d->offCap ? d->offCap * 2 : 16; d->off = xrealloc(d->off, sizeof(uint32_t) * d->offCap); }
+    memcpy(d->arena + d->len, s, len);
+    id = d->count++;
+    d->off[id] = (uint32_t)d->len;
+    d->len += len;
+    unsigned mask = (unsigned)d->slotCap - 1;
+    unsigned h = str_hash(s) & mask;
+    while (d->slots[h] != -1) h = (h + 1) & mask;
+    d->slots[h] = id;
+    return id;
+}
+
+void dict_free(StrDict *d) {
+    free(d->arena); free(d->off); free(d->slots);
+    memset(d, 0, sizeof(*d));
+}
+
+static void catalog_grow(Catalog *c, int need) {
+    if (need <= c->capacity) return;
+    int cap = c->capacity ? c->capacity : 256;
+    while (cap < need) cap *= 2;
+    c->code = xrealloc(c->code, sizeof(int) * cap);
+    c->price = xrealloc(c->price, sizeof(Money) * cap);
+    c->stock = xrealloc(c->stock, sizeof(int) * cap);
+    c->discount = xrealloc(c->discount, sizeof(int) * cap);
+    c->reorder = xrealloc(c->reorder, sizeof(int) * cap);
+    c->avail = xrealloc(c->avail, sizeof(int) * cap);
+    c->nameOff = xrealloc(c->nameOff, sizeof(uint32_t) * cap);
+    c->categoryId = xrealloc(c->categoryId, sizeof(int) * cap);
+    c->subcategoryId = xrealloc(c->subcategoryId, sizeof(int) * cap);
+    c->dirty = xrealloc(c->dirty, cap);
+    memset(c->dirty + c->capacity, 0, cap - c->capacity);
+    c->dirtyList = xrealloc(c->dirtyList, sizeof(int) * cap);
+    c->capacity = cap;
+}
+
+static uint32_t arena_put(Catalog *c, const char *s) {
+    size_t len = strlen(s) + 1;
+    if (c->arenaLen + len > c->arenaCap) {
+        size_t cap = c->arenaCap ? c->arenaCap : 4096;
+        while (cap < c->arenaLen + len) cap *= 2;
+        c->arena = xrealloc(c->arena, cap);
+        c->arenaCap = cap;
+    }
+    uint32_t off = (uint32_t)c->arenaLen;
+    memcpy(c->arena + off, s, len);
+    c->arenaLen += len;
+    return off;
+}
+
+/* Rewrites the arena with only the live names once replaced/deleted
+   names account for more than half of it. */
+static void arena_compact(Catalog *c) {
+    if (c->arenaGarbage * 2 <= c->arenaLen) return;
+    char *old = c->arena;
+    c->arena = NULL; c->arenaLen = 0; c->arenaCap = 0; c->arenaGarbage = 0;
+    for (int i = 0; i < c->count; ++i) {
+        c->nameOff[i] = arena_put(c, old + c->nameOff[i]);
+    }
+    free(old);
+}
+
+const char* catalog_name(const Catalog *c, int idx) { return c->arena + c->nameOff[idx]; }
+const char* catalog_category(const Catalog *c, int idx) { return dict_str(&c->categories, c->categoryId[idx]); }
+const char* catalog_subcategory(const Catalog *c, int idx) { return dict_str(&c->subcategories, c->subcategoryId[idx]); }
+
+/* Appends p without touching the code index; returns its index. */
+int catalog_push(Catalog *c, const Product *p) {
+    catalog_grow(c, c->count + 1);
+    int i = c->count++;
+    c->code[i] = p->code;
+    c->price[i] = p->price;
+    c->stock[i] = p->stock;
+    c->discount[i] = p->discount;
+    c->reorder[i] = p->reorderLevel;
+    c->avail[i] = p->stock;
+    c->nameOff[i] = arena_put(c, p->name);
+    c->categoryId[i] = dict_intern(&c->categories, p->category);
+    c->subcategoryId[i] = dict_intern(&c->subcategories, p->subcategory);
+    return i;
+}
+
+void catalog_product(const Catalog *c, int idx, Product *out) {
+    memset(out, 0, sizeof(*out));
+    out->code = c->code[idx];
+    out->price = c->price[idx];
+    out->stock = c->stock[idx];
+    out->discount = c->discount[idx];
+    out->reorderLevel = c->reorder[idx];
+    strncpy(out->name, catalog_name(c, idx), sizeof(out->name)-1);
+    strncpy(out->category, catalog_category(c, idx), sizeof(out->category)-1);
+    strncpy(out->subcategory, catalog_subcategory(c, idx), sizeof(out->subcategory)-1);
+}
+
+void catalog_set_strings(Catalog *c, int idx, const char *name, const char *category, const char *subcategory) {
+    if (strcmp(name, catalog_name(c, idx)) != 0) {
+        c->arenaGarbage += strlen(catalog_name(c, idx)) + 1;
+        c->nameOff[idx] = arena_put(c, name);
+    }
+    c->categoryId[idx] = dict_intern(&c->categories, category);
+    c->subcategoryId[idx] = dict_intern(&c->subcategories, subcategory);
+    arena_compact(c);
+}
+
+void catalog_free(Catalog *c) {
+    free(c->code); free(c->price); free(c->stock); free(c->discount); free(c->reorder); free(c->avail);
+    free(c->nameOff); free(c->categoryId); free(c->subcategoryId);
+    dict_free(&c->categories); dict_free(&c->subcategories);
+    free(c->arena); free(c->codeIndex); free(c->dirty); free(c->dirtyList);
+    memset(c, 0, sizeof(*c));
+}
+
+/* ---------- Products load/save ---------- */
+int load_products_file(const char *path, Catalog *c) {
+    CsvReader r;
+    if (!csv_open(&r, path)) return 0;
+    int count = 0;
+    while (csv_next(&r, CSV_MAX_FIELDS) > 0) {
+        if (r.nf < 2) continue;
+        Product p;
+        memset(&p, 0, sizeof(p));
+        p.reorderLevel = DEFAULT_REORDER_LEVEL;
+        if (!field_int(r.f[0], &p.code)) continue;
+        field_copy(r.f[1], p.name, sizeof(p.name));
+        int64_t disc = 0;
+        if (r.nf > 2) field_cents(r.f[2], &p.price);
+        if (r.nf > 3) field_int(r.f[3], &p.stock);
+        if (r.nf > 4 && field_cents(r.f[4], &disc)) p.discount = (int)disc;
+        if (r.nf > 5) field_copy(r.f[5], p.category, sizeof(p.category));
+        if (r.nf > 6) field_copy(r.f[6], p.subcategory, sizeof(p.subcategory));
+        if (r.nf > 7) field_int(r.f[7], &p.reorderLevel);
+        if (strlen(p.category) == 0) strcpy(p.category, "Uncategorized");
+        if (strlen(p.subcategory) == 0) strcpy(p.subcategory, "General");
+        catalog_push(c, &p); count++;
+    }
+    csv_close(&r);
+    return count;
+}
+
+/* Flushes stdio buffers and asks the OS to put the file on stable storage. */
+int sync_file(FILE *fp) {
+    if (fflush(fp) != 0) return 0;
+    long long t0 = now_ns();
+#ifdef _WIN32
+    int ok = _commit(_fileno(fp)) == 0;
+#else
+    int ok = fsync(fileno(fp)) == 0;
+#endif
+    stats_time(STAGE_FSYNC, t0);
+    stats_count(CTR_FSYNCS, 1);
+    return ok;
+}
+
+/* Writes to path.tmp and renames it over path, so a crash mid-save never
+   leaves a truncated catalog behind. */
+int save_products_file(const char *path, const Catalog *c) {
+    char tmp[256];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *fp = fopen(tmp, "w");
+    if (!fp) return 0;
+    char price[CENTS_CHARS], disc[CENTS_CHARS];
+    for (int i = 0; i < c->count; ++i) {
+        fprintf(fp, "%d,%s,%s,%d,%s,%s,%s,%d\n",
+                c->code[i], catalog_name(c, i), cents_str(price, c->price[i]), c->stock[i],
+                cents_str(disc, c->discount[i]), catalog_category(c, i), catalog_subcategory(c, i), c->reorder[i]);
+    }
+    int ok = sync_file(fp);
+    if (fclose(fp) != 0) ok = 0;
+    if (!ok) { remove(tmp); return 0; }
+#ifdef _WIN32
+    remove(path);
+#endif
+    return rename(tmp, path) == 0;
+}
+
+/* ---------- Binary catalog (products.bin) ---------- */
+
+static void catalog_to_record(const Catalog *c, int idx, ProductRecord *r) {
+    memset(r, 0, sizeof(*r));
+    r->code = c->code[idx];
+    r->stock = c->stock[idx];
+    r->price = c->price[idx];
+    r->discount = c->discount[idx];
+    r->reorderLevel = c->reorder[idx];
+    strncpy(r->name, catalog_name(c, idx), sizeof(r->name)-1);
+    strncpy(r->category, catalog_category(c, idx), sizeof(r->category)-1);
+    strncpy(r->subcategory, catalog_subcategory(c, idx), sizeof(r->subcategory)-1);
+}
+
+static void record_to_product(const ProductRecord *r, Product *p) {
+    memset(p, 0, sizeof(*p));
+    p->code = r->code;
+    p->stock = r->stock;
+    p->price = r->price;
+    p->discount = (int)r->discount;
+    p->reorderLevel = r->reorderLevel;
+    memcpy(p->name, r->name, sizeof(p->name)-1);
+    memcpy(p->category, r->category, sizeof(p->category)-1);
+    memcpy(p->subcategory, r->subcategory, sizeof(p->subcategory)-1);
+}
+
+/* Returns the record count if buf holds a well-formed catalog image, else -1. */
+static int catalog_bin_validate(const unsigned char *buf, size_t len) {
+    if (len < sizeof(CatalogFileHeader)) return -1;
+    const CatalogFileHeader *h = (const CatalogFileHeader *)buf;
+    if (memcmp(h->magic, CATALOG_MAGIC, sizeof(CATALOG_MAGIC)) != 0) return -1;
+    if (h->version != CATALOG_VERSION || h->recordSize != sizeof(ProductRecord)) return -1;
+    if (len < sizeof(CatalogFileHeader) + (size_t)h->count * sizeof(ProductRecord)) return -1;
+    return (int)h->count;
+}
+
+/* Returns the number of products loaded, or -1 if path is not a catalog
+   image. Older versions are accepted; *version (if given) reports which. */
+int load_products_bin(const char *path, Catalog *c, uint32_t *version) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return -1;
+    CatalogFileHeader h;
+    if (fread(&h, sizeof(h), 1, fp) != 1 || memcmp(h.magic, CATALOG_MAGIC, sizeof(CATALOG_MAGIC)) != 0
+        || !((h.version == CATALOG_VERSION && h.recordSize == sizeof(ProductRecord))
+             || (h.version == 2 && h.recordSize == sizeof(ProductRecordV2))
+             || (h.version == 1 && h.recordSize == CATALOG_V1_RECORD_SIZE))) { fclose(fp); return -1; }
+    if (version) *version = h.version;
+    int count = 0;
+    ProductRecord r;
+    ProductRecordV2 old;
+    Product p;
+    catalog_grow(c, c->count + (int)h.count);
+    memset(&r, 0, sizeof(r));
+    memset(&old, 0, sizeof(old));
+    old.reorderLevel = DEFAULT_REORDER_LEVEL;
+    while (count < (int)h.count && fread(h.version < 3 ? (void *)&old : (void *)&r, h.recordSize, 1, fp) == 1) {
+        if (h.version < 3) {    // same layout with double amounts
+            memcpy(&r, &old, sizeof(r));
+            r.price = (int64_t)(old.price * 100 + 0.5);
+            r.discount = (int64_t)(old.discount * 100 + 0.5);
+        }
+        record_to_product(&r, &p);
+        catalog_push(c, &p); count++;
+    }
+    fclose(fp);
+    return count;
+}
+
+/* Writes a complete image to path.tmp and renames it over path. */
+int save_products_bin(const char *path, const Catalog *c) {
+    char tmp[256];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *fp = fopen(tmp, "wb");
+    if (!fp) return 0;
+    CatalogFileHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, CATALOG_MAGIC, sizeof(CATALOG_MAGIC));
+    h.version = CATALOG_VERSION;
+    h.recordSize = sizeof(ProductRecord);
+    h.count = (uint32_t)c->count;
+    int ok = fwrite(&h, sizeof(h), 1, fp) == 1;
+    for (int i = 0; ok && i < c->count; ++i) {
+        ProductRecord r;
+        catalog_to_record(c, i, &r);
+        ok = fwrite(&r, sizeof(r), 1, fp) == 1;
+    }
+    if (ok) ok = sync_file(fp);
+    if (fclose(fp) != 0) ok = 0;
+    if (!ok) { remove(tmp); return 0; }
+#ifdef _WIN32
+    remove(path);
+#endif
+    return rename(tmp, path) == 0;
+}
+
+int catalog_import_csv(const char *csvPath, const char *binPath) {
+    Catalog tmp;
+    memset(&tmp, 0, sizeof(tmp));
+    int n = load_products_file(csvPath, &tmp);
+    int ok = n > 0 && save_products_bin(binPath, &tmp);
+    catalog_free(&tmp);
+    if (n == 0) { printf("No products read from %s.\n", csvPath); return 0; }
+    if (!ok) { printf("Could not write %s.\n", binPath); return 0; }
+    printf("Imported %d products from %s into %s.\n", n, csvPath, binPath);
+    return 1;
+}
+
+int catalog_export_csv(const char *binPath, const char *csvPath) {
+    Catalog tmp;
+    memset(&tmp, 0, sizeof(tmp));
+    int n = load_products_bin(binPath, &tmp, NULL);
+    int ok = n >= 0 && save_products_file(csvPath, &tmp);
+    catalog_free(&tmp);
+    if (n < 0) { printf("%s is missing or not a valid catalog file.\n", binPath); return 0; }
+    if (!ok) { printf("Could not write %s.\n", csvPath); return 0; }
+    printf("Exported %d products from %s to %s.\n", n, binPath, csvPath);
+    return 1;
+}
+
+/* ---------- Resident catalog ---------- */
+
+static Catalog g_catalog;
+
+static unsigned code_hash(int code) {
+    return (unsigned)code * 2654435761u;
+}
+
+static void catalog_index_put(int idx) {
+    unsigned mask = (unsigned)g_catalog.indexCap - 1;
+    unsigned h = code_hash(g_catalog.code[idx]) & mask;
+    while (g_catalog.codeIndex[h] != -1) h = (h + 1) & mask;
+    g_catalog.codeIndex[h] = idx;
+}
+
+void catalog_index_rebuild() {
+    int cap = 16;
+    while (cap < g_catalog.count * 2) cap <<= 1;
+    if (cap != g_catalog.indexCap) {
+        g_catalog.codeIndex = xrealloc(g_catalog.codeIndex, sizeof(int) * cap);
+        g_catalog.indexCap = cap;
+    }
+    for (int i = 0; i < cap; ++i) g_catalog.codeIndex[i] = -1;
+    for (int i = 0; i < g_catalog.count; ++i) catalog_index_put(i);
+}
+
+static void catalog_map_close() {
+#ifndef _WIN32
+    if (g_catalog.map) munmap(g_catalog.map, g_catalog.mapLen);
+    if (g_catalog.map) close(g_catalog.mapFd);
+#endif
+    g_catalog.map = NULL;
+    g_catalog.mapLen = 0;
+}
+
+/* Maps products.bin read/write. Returns the record count, or -1 if the
+   file is absent or invalid (the caller then falls back to CSV). */
+static int catalog_map_open() {
+#ifdef _WIN32
+    return -1;
+#else
+    int fd = open(PRODUCTS_BIN_FILE, O_RDWR);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(CatalogFileHeader)) { close(fd); return -1; }
+    void *m = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (m == MAP_FAILED) { close(fd); return -1; }
+    int n = catalog_bin_validate(m, (size_t)st.st_size);
+    if (n < 0) { munmap(m, (size_t)st.st_size); close(fd); return -1; }
+    g_catalog.map = m;
+    g_catalog.mapLen = (size_t)st.st_size;
+    g_catalog.mapFd = fd;
+    return n;
+#endif
+}
+
+static void catalog_load_bin_view(int n) {
+    const ProductRecord *recs = (const ProductRecord *)(g_catalog.map + sizeof(CatalogFileHeader));
+    Product p;
+    catalog_grow(&g_catalog, n);
+    for (int i = 0; i < n; ++i) {
+        record_to_product(&recs[i], &p);
+        catalog_push(&g_catalog, &p);
+    }
+}
+
+Catalog* catalog_get() {
+    if (!g_catalog.loaded) {
+        long long t0 = now_ns();
+        uint32_t version = CATALOG_VERSION;
+        int n = catalog_map_open();
+        if (n >= 0) {
+            catalog_load_bin_view(n);
+            g_catalog.backend = CATALOG_BACKEND_BIN;
+        } else if (load_products_bin(PRODUCTS_BIN_FILE, &g_catalog, &version) >= 0) {
+            g_catalog.backend = CATALOG_BACKEND_BIN;   // older image, or no mmap on this platform
+        } else {
+            load_products_file(PRODUCTS_FILE, &g_catalog);
+            g_catalog.backend = CATALOG_BACKEND_CSV;
+        }
+        g_catalog.loaded = 1;
+        catalog_index_rebuild();
+        name_index_rebuild();
+        category_index_rebuild();
+        low_stock_rebuild();
+        stock_journal_replay();
+        if (version != CATALOG_VERSION) catalog_save();   // upgrade the image in place
+        else if (g_catalog.journalLines >= STOCK_JOURNAL_CHECKPOINT) catalog_checkpoint();
+        stats_time(STAGE_CATALOG_LOAD, t0);
+    }
+    return &g_catalog;
+}
+
+int catalog_find(int code) {
+    catalog_get();
+    unsigned mask = (unsigned)g_catalog.indexCap - 1;
+    unsigned h = code_hash(code) & mask;
+    int idx;
+    while ((idx = g_catalog.codeIndex[h]) != -1) {
+        if (g_catalog.code[idx] == code) return idx;
+        h = (h + 1) & mask;
+    }
+    return -1;
+}
+
+/* Returns the new product's index, or -1 if the code exists. */
+int catalog_add(const Product *p) {
+    catalog_get();
+    if (catalog_find(p->code) >= 0) return -1;
+    int idx = catalog_push(&g_catalog, p);
+    if (g_catalog.count * 2 > g_catalog.indexCap) catalog_index_rebuild();
+    else catalog_index_put(idx);
+    name_index_add(idx);
+    category_index_add(idx);
+    low_stock_update(idx);
+    return idx;
+}
+
+/* Replaces everything but code and stock; stock only moves through
+   catalog_apply_stock() so that it is journalled. */
+int catalog_update(int idx, const Product *p) {
+    catalog_get();
+    if (idx < 0 || idx >= g_catalog.count) return 0;
+    int renamed = strcmp(p->name, catalog_name(&g_catalog, idx)) != 0;
+    if (renamed) name_index_remove(idx);
+    category_index_remove(idx);
+    g_catalog.price[idx] = p->price;
+    g_catalog.discount[idx] = p->discount;
+    g_catalog.reorder[idx] = p->reorderLevel;
+    catalog_set_strings(&g_catalog, idx, p->name, p->category, p->subcategory);
+    category_index_add(idx);
+    if (renamed) name_index_add(idx);
+    low_stock_update(idx);
+    return 1;
+}
+
+static void catalog_clear_dirty() {
+    for (int i = 0; i < g_catalog.dirtyCount; ++i) g_catalog.dirty[g_catalog.dirtyList[i]] = 0;
+    g_catalog.dirtyCount = 0;
+}
+
+/* Shifts later products down one slot. Indices change, so the caller must
+   follow up with catalog_save(). */
+int catalog_delete(int idx) {
+    Catalog *c = catalog_get();
+    if (idx < 0 || idx >= c->count) return 0;
+    c->arenaGarbage += strlen(catalog_name(c, idx)) + 1;
+    int tail = c->count - idx - 1;
+    memmove(&c->code[idx], &c->code[idx+1], sizeof(int) * tail);
+    memmove(&c->price[idx], &c->price[idx+1], sizeof(Money) * tail);
+    memmove(&c->stock[idx], &c->stock[idx+1], sizeof(int) * tail);
+    memmove(&c->discount[idx], &c->discount[idx+1], sizeof(int) * tail);
+    memmove(&c->reorder[idx], &c->reorder[idx+1], sizeof(int) * tail);
+    memmove(&c->avail[idx], &c->avail[idx+1], sizeof(int) * tail);
+    memmove(&c->nameOff[idx], &c->nameOff[idx+1], sizeof(uint32_t) * tail);
+    memmove(&c->categoryId[idx], &c->categoryId[idx+1], sizeof(int) * tail);
+    memmove(&c->subcategoryId[idx], &c->subcategoryId[idx+1], sizeof(int) * tail);
+    c->count--;
+    catalog_clear_dirty();
+    arena_compact(c);
+    catalog_index_rebuild();
+    name_index_rebuild();
+    category_index_rebuild();
+    low_stock_rebuild();
+    return 1;
+}
+
+/* Persists the whole catalog. The binary image is rewritten and remapped.
+   Everything the journal held is now in the file, so the journal is dropped. */
+int catalog_save() {
+    catalog_get();
+    long long t0 = now_ns();
+    int ok;
+    const char *path = g_catalog.backend == CATALOG_BACKEND_CSV ? PRODUCTS_FILE : PRODUCTS_BIN_FILE;
+    if (g_catalog.backend == CATALOG_BACKEND_CSV) {
+        ok = save_products_file(PRODUCTS_FILE, &g_catalog);
+    } else {
+        catalog_map_close();
+        ok = save_products_bin(PRODUCTS_BIN_FILE, &g_catalog);
+        catalog_map_open();
+    }
+    stats_time(STAGE_STOCK_SAVE, t0);
+    if (ok) stats_count(CTR_BYTES_CATALOG, file_size(path));
+    if (ok) {
+        remove(STOCK_JOURNAL_FILE);
+        g_group.pending[GC_STOCK_JOURNAL].len = 0;  // queued movements are in the saved catalog
+        g_catalog.journalLines = 0;
+        catalog_clear_dirty();
+    }
+    return ok;
+}
+
+/* Persists a single product. With products.bin this touches only that
+   record; the CSV backend has no record addressing and rewrites the file. */
+int catalog_write_record(int idx) {
+    catalog_get();
+    if (idx < 0 || idx >= g_catalog.count) return 0;
+    if (g_catalog.backend == CATALOG_BACKEND_CSV) return catalog_save();
+    ProductRecord r;
+    catalog_to_record(&g_catalog, idx, &r);
+    size_t off = sizeof(CatalogFileHeader) + (size_t)idx * sizeof(ProductRecord);
+    if (g_catalog.map) {
+        if (off + sizeof(r) > g_catalog.mapLen) return catalog_save();
+        memcpy(g_catalog.map + off, &r, sizeof(r));
+#ifndef _WIN32
+        long page = sysconf(_SC_PAGESIZE);
+        size_t start = off & ~((size_t)page - 1);
+        msync(g_catalog.map + start, off + sizeof(r) - start, MS_ASYNC);
+#endif
+        return 1;
+    }
+    FILE *fp = fopen(PRODUCTS_BIN_FILE, "r+b");
+    if (!fp) return 0;
+    int ok = fseek(fp, (long)off, SEEK_SET) == 0 && fwrite(&r, sizeof(r), 1, fp) == 1;
+    if (fclose(fp) != 0) ok = 0;
+    return ok;
+}
+
+/* ---------- Group commit ---------- */
+/* All commit state is guarded by g_commitLock. A committing lane queues its
+   records and sequence number, then either finds them already written or
+   becomes the leader: it swaps the queues out, drops the lock for the
+   writes and fsyncs, and wakes everyone it covered. Lanes that arrive
+   meanwhile queue behind it and form the next batch. */
+
+static const char *const g_groupFile[GC_FILES] = { RECEIPTS_FILE, STOCK_JOURNAL_FILE, ROLLUP_LOG_FILE, RECEIPT_INDEX_FILE };
+
+static void tb_printf(TextBuf *b, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(b->data ? b->data + b->len : NULL, b->data ? b->cap - b->len : 0, fmt, ap);
+    va_end(ap);
+    if (n < 0) return;
+    if (b->len + (size_t)n + 1 > b->cap) {
+        while (b->len + (size_t)n + 1 > b->cap) b->cap = b->cap ? b->cap * 2 : 4096;
+        b->data = xrealloc(b->data, b->cap);
+        va_start(ap, fmt);
+        vsnprintf(b->data + b->len, b->cap - b->len, fmt, ap);
+        va_end(ap);
+    }
+    b->len += (size_t)n;
+}
+
+static void tb_write(TextBuf *b, const void *p, size_t n) {
+    if (b->len + n > b->cap) {
+        while (b->len + n > b->cap) b->cap = b->cap ? b->cap * 2 : 4096;
+        b->data = xrealloc(b->data, b->cap);
+    }
+    memcpy(b->data + b->len, p, n);
+    b->len += n;
+}
+
+/* Writes out everything queued so far. Called and returns with
+   g_commitLock held; the lock is dropped during I/O. */
+static void group_flush_locked() {
+    g_group.flushing = 1;
+    if (g_commitConfig.windowUs > 0 && g_group.queued - g_group.written < g_commitConfig.maxBatch) {
+        mutex_unlock(&g_commitLock);
+        sleep_us(g_commitConfig.windowUs);
+        mutex_lock(&g_commitLock);
+    }
+    TextBuf out[GC_FILES];
+    for (int f = 0; f < GC_FILES; ++f) {
+        out[f] = g_group.pending[f];
+        g_group.pending[f] = g_group.spare[f];
+    }
+    long long upto = g_group.queued, batch = upto - g_group.written;
+    int rid = g_group.lastReceipt;
+    mutex_unlock(&g_commitLock);
+
+    int syncs = 0;
+    if (out[GC_RECEIPTS].len) receipt_log_maybe_rotate(out[GC_RECEIPTS].data, out[GC_RECEIPTS].len);
+    for (int f = 0; f < GC_FILES; ++f) {
+        if (out[f].len == 0) continue;
+        long long t0 = now_ns();
+        FILE *fp = fopen(g_groupFile[f], "ab");
+        int ok = fp && fwrite(out[f].data, 1, out[f].len, fp) == out[f].len;
+        if (ok && g_commitConfig.durability == DURABILITY_FSYNC) { ok = sync_file(fp); syncs++; }
+        if (fp && fclose(fp) != 0) ok = 0;
+        if (!ok) printf("Warning: cannot append to %s\n", g_groupFile[f]);
+        stats_time(STAGE_WRITE_RECEIPTS + f, t0);
+        stats_count(CTR_BYTES_RECEIPTS + f, (long long)out[f].len);
+        out[f].len = 0;
+    }
+    if (rid > g_group.storedReceipt) {  // only the leader touches storedReceipt
+        receipt_seq_store(rid);
+        g_group.storedReceipt = rid;
+    }
+
+    mutex_lock(&g_commitLock);
+    for (int f = 0; f < GC_FILES; ++f) g_group.spare[f] = out[f];
+    g_group.written = upto;
+    g_group.flushing = 0;
+    g_group.oldestAt = now_seconds();
+    g_group.flushes++;
+    stats_count(CTR_COMMIT_BATCHES, 1);
+    g_group.syncs += syncs;
+    if (batch > g_group.maxBatch) g_group.maxBatch = batch;
+    g_group.lastAt = now_seconds();
+    // only fold the journal when nothing newer is queued behind what was just written
+    if (g_catalog.journalLines >= STOCK_JOURNAL_CHECKPOINT && g_group.pending[GC_STOCK_JOURNAL].len == 0)
+        catalog_checkpoint();
+    cond_broadcast(&g_commitDone);
+}
+
+/* Marks one checkout's records as queued and applies the durability
+   policy. Called and returns with g_commitLock held. */
+static void group_commit_locked() {
+    long long mine = ++g_group.queued;
+    double now = now_seconds();
+    if (g_group.checkouts++ == 0) g_group.firstAt = now;
+    if (mine == g_group.written + 1) g_group.oldestAt = now;
+    if (g_commitConfig.durability == DURABILITY_ASYNC) {
+        if (!g_group.flushing && (g_group.queued - g_group.written >= g_commitConfig.maxBatch
+                                  || now - g_group.oldestAt >= g_commitConfig.windowUs / 1e6))
+            group_flush_locked();
+        return;
+    }
+    while (g_group.written < mine) {
+        if (!g_group.flushing) group_flush_locked();
+        else cond_wait(&g_commitDone, &g_commitLock);
+    }
+}
+
+/* Writes out anything still queued. Called and returns with g_commitLock
+   held; nothing is queued or being written on return. */
+static void group_drain_locked() {
+    while (1) {
+        while (g_group.flushing) cond_wait(&g_commitDone, &g_commitLock);
+        int more = g_group.queued > g_group.written;
+        for (int f = 0; f < GC_FILES; ++f) if (g_group.pending[f].len) more = 1;
+        if (!more) return;
+        group_flush_locked();
+    }
+}
+
+/* Writes out anything still queued, e.g. async checkouts at exit or a
+   journal entry from the admin menu. */
+void group_commit_flush() {
+    mutex_lock(&g_commitLock);
+    group_drain_locked();
+    mutex_unlock(&g_commitLock);
+}
+
+void group_commit_report() {
+    static const char *const mode[] = { "async", "write", "fsync" };
+    if (g_group.checkouts == 0) return;
+    double span = g_group.lastAt - g_group.firstAt;
+    printf("group commit (%s, window %dus, batch %d): %lld checkouts in %lld flushes (avg %.1f, max %lld), %lld fsyncs",
+           mode[g_commitConfig.durability], g_commitConfig.windowUs, g_commitConfig.maxBatch, g_group.checkouts,
+           g_group.flushes, g_group.flushes ? (double)g_group.checkouts / g_group.flushes : 0.0, g_group.maxBatch, g_group.syncs);
+    if (span > 0) printf(", %.0f checkouts/s", g_group.checkouts / span);
+    printf("\n");
+}
+
+/* ---------- Stock journal ---------- */
+/* stock.journal holds one "code,delta,stock" line per stock movement since
+   the last checkpoint. The resulting stock is recorded alongside the delta
+   so replay is idempotent: a crash between folding the journal into the
+   catalog and deleting it cannot apply a movement twice. */
+
+/* reserved: the units were taken from avail by stock_reserve() already, so
+   only the part of -delta that could not be removed is handed back. */
+static int catalog_move_stock(int idx, int delta, int reserved) {
+    int s = g_catalog.stock[idx] + delta;
+    if (s < 0) s = 0;
+    int change = s - g_catalog.stock[idx];
+    category_index_stock(idx, change);
+    g_catalog.stock[idx] = s;
+    atomic_add_int(&g_catalog.avail[idx], reserved ? change - delta : change);
+    low_stock_update(idx);
+    if (!g_catalog.dirty[idx]) {
+        g_catalog.dirty[idx] = 1;
+        g_catalog.dirtyList[g_catalog.dirtyCount++] = idx;
+    }
+    return s;
+}
+
+int catalog_apply_stock(int idx, int delta) {
+    return catalog_move_stock(idx, delta, 0);
+}
+
+/* Takes qty reserved units out of stock for good. Caller holds g_commitLock. */
+int catalog_commit_reserved(int idx, int qty) {
+    return catalog_move_stock(idx, -qty, 1);
+}
+
+/* Lock-free: claims qty units of idx for an open cart, or fails if fewer
+   are available. */
+int stock_reserve(int idx, int qty) {
+    int *a = &g_catalog.avail[idx];
+    int cur = atomic_load_int(a);
+    while (cur >= qty)
+        if (atomic_cas_int(a, &cur, cur - qty)) return 1;
+    return 0;
+}
+
+void stock_release(int idx, int qty) {
+    atomic_add_int(&g_catalog.avail[idx], qty);
+}
+
+int stock_available(int idx) {
+    return atomic_load_int(&g_catalog.avail[idx]);
+}
+
+/* Queues one record per movement for the next group commit; the catalog
+   must already hold the new stock. Callers outside a checkout follow up
+   with group_commit_flush(). */
+int stock_journal_append(const int idx[], const int delta[], int n) {
+    for (int i = 0; i < n; ++i)
+        tb_printf(&g_group.pending[GC_STOCK_JOURNAL], "%d,%d,%d\n", g_catalog.code[idx[i]], delta[i], g_catalog.stock[idx[i]]);
+    g_catalog.journalLines += n;
+    return 1;
+}
+
+/* Returns the number of movements applied. A torn final line is ignored. */
+int stock_journal_replay() {
+    CsvReader r;
+    if (!csv_open(&r, STOCK_JOURNAL_FILE)) return 0;
+    int applied = 0;
+    while (csv_next(&r, 3) > 0 && !r.torn) {
+        int code, stock;
+        if (r.nf != 3 || !field_int(r.f[0], &code) || !field_int(r.f[2], &stock)) continue;
+        int idx = catalog_find(code);
+        if (idx < 0) continue;
+        catalog_apply_stock(idx, stock - g_catalog.stock[idx]);
+        applied++;
+    }
+    csv_close(&r);
+    g_catalog.journalLines = applied;
+    return applied;
+}
+
+/* Folds journalled movements into the catalog file. The binary image is
+   patched in place for the changed records only; CSV is rewritten. */
+int catalog_checkpoint() {
+    if (g_catalog.dirtyCount == 0 && g_catalog.journalLines == 0) return 1;
+    if (g_catalog.backend == CATALOG_BACKEND_CSV) return catalog_save();
+    long long t0 = now_ns();
+    int ok = 1;
+    for (int i = 0; i < g_catalog.dirtyCount; ++i)
+        if (!catalog_write_record(g_catalog.dirtyList[i])) ok = 0;
+#ifndef _WIN32
+    if (ok && g_catalog.map && msync(g_catalog.map, g_catalog.mapLen, MS_SYNC) != 0) ok = 0;
+#endif
+    stats_time(STAGE_STOCK_SAVE, t0);
+    stats_count(CTR_BYTES_CATALOG, (long long)g_catalog.dirtyCount * (long long)sizeof(ProductRecord));
+    if (!ok) return 0;
+    remove(STOCK_JOURNAL_FILE);
+    g_group.pending[GC_STOCK_JOURNAL].len = 0;
+    g_catalog.journalLines = 0;
+    catalog_clear_dirty();
+    return 1;
+}
+
+/* ---------- Name search index ---------- */
+/* Case-folded trigram inverted index over product names. Every run of
+   three bytes in a name is a key; word starts additionally get boundary
+   keys (NAME_BOUND,NAME_BOUND,c) and (NAME_BOUND,c,d) so one- and
+   two-character queries resolve as word-prefix lookups. Posting lists
+   hold product indices in ascending order. */
+#define NAME_BOUND 0x01
+#define SEARCH_MAX_RESULTS 50
+
+typedef struct {
+    uint32_t key;   // 0 marks an empty slot
+    IdList ids;
+} NamePosting;
+
+typedef struct {
+    NamePosting *slots;
+    int cap, used;
+} NameIndex;
+
+static NameIndex g_nameIndex;
+
+static uint32_t trigram_key(unsigned char a, unsigned char b, unsigned char c) {
+    return ((uint32_t)a << 16) | ((uint32_t)b << 8) | c;
+}
+
+static int is_word_char(unsigned char ch) {
+    return isalnum(ch) || ch >= 0x80;
+}
+
+static NamePosting* name_posting(uint32_t key, int create) {
+    if (g_nameIndex.cap == 0) {
+        if (!create) return NULL;
+        g_nameIndex.cap = 1024;
+        g_nameIndex.slots = calloc(g_nameIndex.cap, sizeof(NamePosting));
+        if (!g_nameIndex.slots) { printf("Out of memory.\n"); exit(1); }
+    }
+    unsigned mask = (unsigned)g_nameIndex.cap - 1;
+    unsigned h = (key * 2654435761u) & mask;
+    while (g_nameIndex.slots[h].key != 0) {
+        if (g_nameIndex.slots[h].key == key) return &g_nameIndex.slots[h];
+        h = (h + 1) & mask;
+    }
+    if (!create) return NULL;
+    if ((g_nameIndex.used + 1) * 2 > g_nameIndex.cap) {
+        NamePosting *old = g_nameIndex.slots;
+        int oldCap = g_nameIndex.cap;
+        g_nameIndex.cap *= 2;
+        g_nameIndex.slots = calloc(g_nameIndex.cap, sizeof(NamePosting));
+        if (!g_nameIndex.slots) { printf("Out of memory.\n"); exit(1); }
+        mask = (unsigned)g_nameIndex.cap - 1;
+        for (int i = 0; i < oldCap; ++i) {
+            if (old[i].key == 0) continue;
+            unsigned j = (old[i].key * 2654435761u) & mask;
+            while (g_nameIndex.slots[j].key != 0) j = (j + 1) & mask;
+            g_nameIndex.slots[j] = old[i];
+        }
+        free(old);
+        return name_posting(key, 1);
+    }
+    g_nameIndex.slots[h].key = key;
+    g_nameIndex.used++;
+    return &g_nameIndex.slots[h];
+}
+
+static void posting_insert(uint32_t key, int id) {
+    idlist_insert(&name_posting(key, 1)->ids, id);
+}
+
+static void posting_erase(uint32_t key, int id) {
+    NamePosting *p = name_posting(key, 0);
+    if (p) idlist_erase(&p->ids, id);
+}
+
+static void name_index_each_key(const char *name, int id, void (*fn)(uint32_t, int)) {
+    unsigned char buf[256];
+    size_t n = 0;
+    for (; name[n] && n < sizeof(buf); ++n) buf[n] = (unsigned char)tolower((unsigned char)name[n]);
+    for (size_t i = 0; i < n; ++i) {
+        if (is_word_char(buf[i]) && (i == 0 || !is_word_char(buf[i-1]))) {
+            fn(trigram_key(NAME_BOUND, NAME_BOUND, buf[i]), id);
+            if (i + 1 < n) fn(trigram_key(NAME_BOUND, buf[i], buf[i+1]), id);
+        }
+        if (i + 2 < n) fn(trigram_key(buf[i], buf[i+1], buf[i+2]), id);
+    }
+}
+
+void name_index_add(int idx) {
+    name_index_each_key(catalog_name(&g_catalog, idx), idx, posting_insert);
+}
+
+void name_index_remove(int idx) {
+    name_index_each_key(catalog_name(&g_catalog, idx), idx, posting_erase);
+}
+
+void name_index_rebuild() {
+    for (int i = 0; i < g_nameIndex.cap; ++i) g_nameIndex.slots[i].ids.count = 0;
+    for (int i = 0; i < g_catalog.count; ++i) name_index_add(i);
+}
+
+/* Position of needle (already lower-case) in hay ignoring case, or -1. */
+static int find_ci(const char *hay, const char *needle, size_t nlen) {
+    for (size_t i = 0; hay[i]; ++i) {
+        size_t k = 0;
+        while (k < nlen && hay[i+k] && tolower((unsigned char)hay[i+k]) == (unsigned char)needle[k]) k++;
+        if (k == nlen) return (int)i;
+    }
+    return -1;
+}
+
+typedef struct { int idx; int rank; int pos; int len; } SearchHit;
+
+static int compare_hits(const void *a, const void *b) {
+    const SearchHit *x = a, *y = b;
+    if (x->rank != y->rank) return x->rank - y->rank;
+    if (x->pos != y->pos) return x->pos - y->pos;
+    if (x->len != y->len) return x->len - y->len;
+    return x->idx - y->idx;
+}
+
+/* Fills out[] with up to max product indices whose name contains term,
+   ranked name-prefix first, then word-prefix, then any substring.
+   Returns the total number of matches (which may exceed max). Terms
+   shorter than three characters only match at word starts. */
+int name_index_search(const char *term, int out[], int max) {
+    catalog_get();
+    char q[128];
+    size_t n = 0;
+    for (; term[n] && n < sizeof(q) - 1; ++n) q[n] = (char)tolower((unsigned char)term[n]);
+    q[n] = '\0';
+    if (n == 0) return 0;
+
+    /* drive from the shortest posting list among the query's keys */
+    const IdList *best = NULL;
+    if (n < 3) {
+        uint32_t key = n == 1 ? trigram_key(NAME_BOUND, NAME_BOUND, (unsigned char)q[0])
+                              : trigram_key(NAME_BOUND, (unsigned char)q[0], (unsigned char)q[1]);
+        const NamePosting *p = name_posting(key, 0);
+        best = p ? &p->ids : NULL;
+    } else {
+        for (size_t i = 0; i + 2 < n; ++i) {
+            const NamePosting *p = name_posting(trigram_key((unsigned char)q[i], (unsigned char)q[i+1], (unsigned char)q[i+2]), 0);
+            if (!p || p->ids.count == 0) return 0;
+            if (!best || p->ids.count < best->count) best = &p->ids;
+        }
+    }
+    if (!best || best->count == 0) return 0;
+
+    SearchHit *hits = malloc(sizeof(SearchHit) * best->count);
+    if (!hits) return 0;
+    int found = 0;
+    for (int i = 0; i < best->count; ++i) {
+        int idx = best->ids[i];
+        const char *name = catalog_name(&g_catalog, idx);
+        int pos = find_ci(name, q, n);
+        if (pos < 0) continue;
+        int wordStart = pos == 0 || !is_word_char((unsigned char)name[pos-1]);
+        if (n < 3 && !wordStart) {
+            /* the first hit was mid-word; look for one at a word start */
+            for (int j = pos + 1; name[j]; ++j) {
+                if (!is_word_char((unsigned char)name[j-1]) && find_ci(name + j, q, n) == 0) { pos = j; wordStart = 1; break; }
+            }
+            if (!wordStart) continue;
+        }
+        hits[found].idx = idx;
+        hits[found].rank = pos == 0 ? 0 : (wordStart ? 1 : 2);
+        hits[found].pos = pos;
+        hits[found].len = (int)strlen(name);
+        found++;
+    }
+    qsort(hits, found, sizeof(SearchHit), compare_hits);
+    for (int i = 0; i < found && i < max; ++i) out[i] = hits[i].idx;
+    free(hits);
+    return found;
+}
+
+/* ---------- Category index ---------- */
+/* One posting list of product indices per (category, subcategory) pair,
+   reachable from its category, plus per-category totals that are kept
+   current on every add, edit and stock movement so summaries never scan
+   the catalog. */
+
+typedef struct {
+    int category, subcategory;
+    IdList members;
+} CategoryGroup;
+
+typedef struct {
+    int products;
+    long units;     // sum of stock
+    Money value;    // sum of price * stock
+} CategorySummary;
+
+typedef struct {
+    CategoryGroup *groups;
+    int groupCount, groupCap;
+    int *groupSlots;    // (category, subcategory) -> group, -1 marks empty
+    int slotCap;
+    IdList *byCategory; // category id -> group ids
+    CategorySummary *summary;
+    int catCap;
+} CategoryIndex;
+
+static CategoryIndex g_categoryIndex;
+
+static unsigned pair_hash(int a, int b) {
+    return ((unsigned)a * 2654435761u) ^ ((unsigned)b * 40503u);
+}
+
+static void category_slots_rehash(int cap) {
+    CategoryIndex *ci = &g_categoryIndex;
+    ci->groupSlots = xrealloc(ci->groupSlots, sizeof(int) * cap);
+    ci->slotCap = cap;
+    for (int i = 0; i < cap; ++i) ci->groupSlots[i] = -1;
+    unsigned mask = (unsigned)cap - 1;
+    for (int g = 0; g < ci->groupCount; ++g) {
+        unsigned h = pair_hash(ci->groups[g].category, ci->groups[g].subcategory) & mask;
+        while (ci->groupSlots[h] != -1) h = (h + 1) & mask;
+        ci->groupSlots[h] = g;
+    }
+}
+
+/* Returns the group id for (category, subcategory), or -1 if absent and !create. */
+static int category_group(int category, int subcategory, int create) {
+    CategoryIndex *ci = &g_categoryIndex;
+    unsigned h = 0;     // on a miss, the empty slot the group would take
+    if (ci->slotCap) {
+        unsigned mask = (unsigned)ci->slotCap - 1;
+        int g;
+        h = pair_hash(category, subcategory) & mask;
+        while ((g = ci->groupSlots[h]) != -1) {
+            if (ci->groups[g].category == category && ci->groups[g].subcategory == subcategory) return g;
+            h = (h + 1) & mask;
+        }
+    }
+    if (!create) return -1;
+    if (category >= ci->catCap) {
+        int cap = ci->catCap ? ci->catCap : 16;
+        while (cap <= category) cap *= 2;
+        ci->byCategory = xrealloc(ci->byCategory, sizeof(IdList) * cap);
+        ci->summary = xrealloc(ci->summary, sizeof(CategorySummary) * cap);
+        memset(ci->byCategory + ci->catCap, 0, sizeof(IdList) * (cap - ci->catCap));
+        memset(ci->summary + ci->catCap, 0, sizeof(CategorySummary) * (cap - ci->catCap));
+        ci->catCap = cap;
+    }
+    if (ci->groupCount == ci->groupCap) {
+        ci->groupCap = ci->groupCap ? ci->groupCap * 2 : 32;
+        ci->groups = xrealloc(ci->groups, sizeof(CategoryGroup) * ci->groupCap);
+    }
+    int g = ci->groupCount++;
+    memset(&ci->groups[g], 0, sizeof(CategoryGroup));
+    ci->groups[g].category = category;
+    ci->groups[g].subcategory = subcategory;
+    idlist_insert(&ci->byCategory[category], g);
+    if (ci->groupCount * 2 > ci->slotCap) category_slots_rehash(ci->slotCap ? ci->slotCap * 2 : 64);
+    else ci->groupSlots[h] = g;
+    return g;
+}
+
+void category_index_add(int idx) {
+    const Catalog *c = &g_catalog;
+    int g = category_group(c->categoryId[idx], c->subcategoryId[idx], 1);
+    idlist_insert(&g_categoryIndex.groups[g].members, idx);
+    CategorySummary *s = &g_categoryIndex.summary[c->categoryId[idx]];
+    s->products++;
+    s->units += c->stock[idx];
+    s->value += c->price[idx] * c->stock[idx];
+}
+
+void category_index_remove(int idx) {
+    const Catalog *c = &g_catalog;
+    int g = category_group(c->categoryId[idx], c->subcategoryId[idx], 0);
+    if (g < 0) return;
+    idlist_erase(&g_categoryIndex.groups[g].members, idx);
+    CategorySummary *s = &g_categoryIndex.summary[c->categoryId[idx]];
+    s->products--;
+    s->units -= c->stock[idx];
+    s->value -= c->price[idx] * c->stock[idx];
+}
+
+void category_index_stock(int idx, int delta) {
+    const Catalog *c = &g_catalog;
+    if (c->categoryId[idx] >= g_categoryIndex.catCap) return;
+    CategorySummary *s = &g_categoryIndex.summary[c->categoryId[idx]];
+    s->units += delta;
+    s->value += c->price[idx] * delta;
+}
+
+void category_index_rebuild() {
+    CategoryIndex *ci = &g_categoryIndex;
+    for (int g = 0; g < ci->groupCount; ++g) ci->groups[g].members.count = 0;
+    if (ci->summary) memset(ci->summary, 0, sizeof(CategorySummary) * ci->catCap);
+    for (int i = 0; i < g_catalog.count; ++i) category_index_add(i);
+}
+
+/* Calls fn for every product in the given category/subcategory id; -1 is
+   a wildcard. Only the matching posting lists are walked. */
+int category_index_visit(int category, int subcategory, void (*fn)(int idx, void *ctx), void *ctx) {
+    CategoryIndex *ci = &g_categoryIndex;
+    int n = 0;
+    if (category < 0 && subcategory < 0) {
+        for (int i = 0; i < g_catalog.count; ++i) { fn(i, ctx); n++; }
+        return n;
+    }
+    if (category >= 0 && subcategory >= 0) {
+        int g = category_group(category, subcategory, 0);
+        if (g < 0) return 0;
+        for (int k = 0; k < ci->groups[g].members.count; ++k) { fn(ci->groups[g].members.ids[k], ctx); n++; }
+        return n;
+    }
+    if (category >= 0) {
+        if (category >= ci->catCap) return 0;
+        const IdList *gl = &ci->byCategory[category];
+        for (int j = 0; j < gl->count; ++j) {
+            const IdList *m = &ci->groups[gl->ids[j]].members;
+            for (int k = 0; k < m->count; ++k) { fn(m->ids[k], ctx); n++; }
+        }
+        return n;
+    }
+    for (int g = 0; g < ci->groupCount; ++g) {
+        if (ci->groups[g].subcategory != subcategory) continue;
+        for (int k = 0; k < ci->groups[g].members.count; ++k) { fn(ci->groups[g].members.ids[k], ctx); n++; }
+    }
+    return n;
+}
+
+const CategorySummary* category_summary(int category) {
+    if (category < 0 || category >= g_categoryIndex.catCap) return NULL;
+    return &g_categoryIndex.summary[category];
+}
+
+/* ---------- Low-stock watchlist ---------- */
+
+/* Products with stock below their reorder threshold, kept as an unordered
+   set: `members` holds the product indices and pos[idx] is the slot of idx
+   in it (-1 when absent), so membership changes are O(1) and listing the
+   alerts never touches healthy products. */
+typedef struct {
+    int *members;
+    int count;
+    int *pos;
+    int cap;
+} LowStockSet;
+
+static LowStockSet g_lowStock;
+
+void low_stock_update(int idx) {
+    LowStockSet *ls = &g_lowStock;
+    if (ls->cap < g_catalog.capacity) {
+        ls->members = xrealloc(ls->members, sizeof(int) * g_catalog.capacity);
+        ls->pos = xrealloc(ls->pos, sizeof(int) * g_catalog.capacity);
+        for (int i = ls->cap; i < g_catalog.capacity; ++i) ls->pos[i] = -1;
+        ls->cap = g_catalog.capacity;
+    }
+    int low = g_catalog.stock[idx] < g_catalog.reorder[idx];
+    if (low && ls->pos[idx] < 0) {
+        ls->pos[idx] = ls->count;
+        ls->members[ls->count++] = idx;
+    } else if (!low && ls->pos[idx] >= 0) {
+        int last = ls->members[--ls->count];
+        ls->members[ls->pos[idx]] = last;
+        ls->pos[last] = ls->pos[idx];
+        ls->pos[idx] = -1;
+    }
+}
+
+void low_stock_rebuild() {
+    LowStockSet *ls = &g_lowStock;
+    ls->count = 0;
+    for (int i = 0; i < ls->cap; ++i) ls->pos[i] = -1;
+    for (int i = 0; i < g_catalog.count; ++i) low_stock_update(i);
+}
+
+static int low_stock_cmp(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    int sx = g_catalog.reorder[x] - g_catalog.stock[x], sy = g_catalog.reorder[y] - g_catalog.stock[y];
+    if (sx != sy) return sy - sx;   // largest shortfall first
+    return g_catalog.code[x] - g_catalog.code[y];
+}
+
+/* Copies up to max alerts into out, most urgent first; returns how many. */
+int low_stock_list(int out[], int max) {
+    catalog_get();
+    int n = g_lowStock.count < max ? g_lowStock.count : max;
+    if (n < g_lowStock.count) {
+        int *all = xrealloc(NULL, sizeof(int) * g_lowStock.count);
+        memcpy(all, g_lowStock.members, sizeof(int) * g_lowStock.count);
+        qsort(all, g_lowStock.count, sizeof(int), low_stock_cmp);
+        memcpy(out, all, sizeof(int) * n);
+        free(all);
+    } else {
+        memcpy(out, g_lowStock.members, sizeof(int) * n);
+        qsort(out, n, sizeof(int), low_stock_cmp);
+    }
+    return n;
+}
+
+/* Machine-readable alert feed for replenishment jobs: code,name,stock,threshold. */
+void low_stock_print_csv() {
+    Catalog *c = catalog_get();
+    int n = g_lowStock.count;
+    if (n == 0) return;
+    int *ids = xrealloc(NULL, sizeof(int) * n);
+    n = low_stock_list(ids, n);
+    for (int i = 0; i < n; ++i)
+        printf("%d,%s,%d,%d\n", c->code[ids[i]], catalog_name(c, ids[i]), c->stock[ids[i]], c->reorder[ids[i]]);
+    free(ids);
+}
+
+/* ---------- Admin functions ---------- */
+
+/* Per-stage latency and write counters since startup or the last reset. */
+void admin_stats() {
+    stats_print(stdout);
+    printf("Reset stats? (y/N): ");
+    char buf[8];
+    if (fgets(buf, sizeof(buf), stdin) && (buf[0] == 'y' || buf[0] == 'Y')) { stats_reset(); printf("Stats reset.\n"); }
+}
+
+void admin_menu() {
+    while (1) {
+        printf("\n==== STORE PERSON MENU ====\n");
+        printf("1. Add Product\n");
+        printf("2. View All Products\n");
+        printf("3. View Products by Category/Subcategory\n");
+        printf("4. Update Product\n");
+        printf("5. Delete Product\n");
+        printf("6. Low-stock Alerts (below reorder threshold)\n");
+        printf("7. Reports Menu\n");
+        printf("8. Category Summary\n");
+        printf("9. Checkout Stats\n");
+        printf("0. Back to Role Selection\n");
+        printf("Enter choice: ");
+        int ch;
+        if (scanf("%d", &ch) != 1) { while (getchar() != '\n'); ch = -1; }
+        while (getchar() != '\n');
+        if (ch == 0) return;
+        switch (ch) {
+            case 1: admin_add_product(); break;
+            case 2: admin_view_products(); break;
+            case 3: admin_view_by_category(); break;
+            case 4: admin_update_product(); break;
+            case 5: admin_delete_product(); break;
+            case 6: admin_low_stock_alerts(); break;
+            case 7: report_menu(); break;
+            case 8: admin_category_summary(); break;
+            case 9: admin_stats(); break;
+            default: printf("Invalid choice.\n");
+        }
+    }
+}
+
+void admin_add_product() {
+    catalog_get();
+    Product p;
+    memset(&p, 0, sizeof(p));
+    printf("Enter product code (int): ");
+    if (scanf("%d", &p.code) != 1) { printf("Invalid.\n"); while(getchar()!='\n'); return; }
+    while(getchar()!='\n');
+    if (catalog_find(p.code) >= 0) { printf("Product code exists.\n"); return; }
+    printf("Enter product name: ");
+    fgets(p.name, sizeof(p.name), stdin); trimnewline(p.name);
+    char in[32];
+    int64_t disc = 0;
+    printf("Enter price (e.g. 99.99): "); if (scanf("%31s", in) == 1) cents_parse(in, &p.price); while(getchar()!='\n');
+    printf("Enter stock (int): "); scanf("%d", &p.stock); while(getchar()!='\n');
+    printf("Enter discount percentage (e.g. 5.0): "); if (scanf("%31s", in) == 1 && cents_parse(in, &disc)) p.discount = (int)disc; while(getchar()!='\n');
+    printf("Enter category: "); fgets(p.category, sizeof(p.category), stdin); trimnewline(p.category);
+    printf("Enter subcategory: "); fgets(p.subcategory, sizeof(p.subcategory), stdin); trimnewline(p.subcategory);
+    printf("Enter reorder threshold (blank for %d): ", DEFAULT_REORDER_LEVEL);
+    char tmp[32]; fgets(tmp, sizeof(tmp), stdin);
+    if (sscanf(tmp, "%d", &p.reorderLevel) != 1 || p.reorderLevel < 0) p.reorderLevel = DEFAULT_REORDER_LEVEL;
+    catalog_add(&p);
+    if (!catalog_save()) printf("Failed to save products.\n");
+    else printf("Product added.\n");
+}
+
+void admin_view_products() {
+    Catalog *c = catalog_get();
+    int n = c->count;
+    if (n == 0) { printf("No products found.\n"); return; }
+    char price[CENTS_CHARS], disc[CENTS_CHARS];
+    printf("\nCode | Name | Price | Stock | Disc | Category > Sub\n");
+    printf("--------------------------------------------------------------\n");
+    for (int i = 0; i < n; ++i) {
+        printf("%4d | % -25s | %7s | %5d | %5s%% | %s > %s\n",
+               c->code[i], catalog_name(c, i), cents_str(price, c->price[i]), c->stock[i],
+               cents_str(disc, c->discount[i]), catalog_category(c, i), catalog_subcategory(c, i));
+    }
+    printf("Total products: %d\n", n);
+    printf("+------+---------------------------+---------+-------+--------+-------------------+-------------------+\n");
+    printf("| Code | Name                      | Price   | Stock | Disc%%  | Category          | Subcategory        |\n");
+    printf("+------+---------------------------+---------+-------+--------+-------------------+-------------------+\n");
+    for (int i = 0; i < n; ++i) {
+        printf("| %-4d | %-25s | %7s | %5d | %6s | %-17s | %-17s |\n",
+               c->code[i], catalog_name(c, i), cents_str(price, c->price[i]), c->stock[i],
+               cents_str(disc, c->discount[i]), catalog_category(c, i), catalog_subcategory(c, i));
+    }
+    printf("+------+---------------------------+---------+-------+--------+-------------------+-------------------+\n");
+}
+
+static void print_product_row(int idx, void *count) {
+    const Catalog *c = &g_catalog;
+    char price[CENTS_CHARS], disc[CENTS_CHARS];
+    printf("| %-4d | %-25s | %7s | %5d | %6s | %-17s | %-17s |\n",
+           c->code[idx], catalog_name(c, idx), cents_str(price, c->price[idx]), c->stock[idx],
+           cents_str(disc, c->discount[idx]), catalog_category(c, idx), catalog_subcategory(c, idx));
+    (*(int *)count)++;
+}
+
+void admin_view_by_category() {
+    Catalog *c = catalog_get();
+    if (c->count == 0) { printf("No products.\n"); return; }
+    printf("Enter category (or 'all'): ");
+    char cat[64]; fgets(cat, sizeof(cat), stdin); trimnewline(cat);
+    printf("Enter subcategory (or 'all'): ");
+    char sub[64]; fgets(sub, sizeof(sub), stdin); trimnewline(sub);
+    int catId = (strcmp(cat, "all")==0 || strlen(cat)==0) ? -1 : dict_find(&c->categories, cat);
+    int subId = (strcmp(sub, "all")==0 || strlen(sub)==0) ? -1 : dict_find(&c->subcategories, sub);
+    int unknown = (catId < 0 && strcmp(cat, "all") != 0 && strlen(cat) != 0)
+               || (subId < 0 && strcmp(sub, "all") != 0 && strlen(sub) != 0);
+    int cnt = 0;
+    printf("+------+---------------------------+---------+-------+--------+-------------------+-------------------+\n");
+    printf("| Code | Name                      | Price   | Stock | Disc%%  | Category          | Subcategory        |\n");
+    printf("+------+---------------------------+---------+-------+--------+-------------------+-------------------+\n");
+    if (!unknown) category_index_visit(catId, subId, print_product_row, &cnt);
+    printf("+------+---------------------------+---------+-------+--------+-------------------+-------------------+\n");
+    if (cnt == 0) printf("No matching products.\n");
+}
+
+void admin_update_product() {
+    if (catalog_get()->count == 0) { printf("No products.\n"); return; }
+    int code; printf("Enter product code to update: "); if (scanf("%d", &code) != 1) { while(getchar()!='\n'); printf("Invalid.\n"); return; }
+    while(getchar()!='\n');
+    int idx = catalog_find(code);
+    if (idx == -1) { printf("Not found.\n"); return; }
+    Product prod, *p = &prod;
+    catalog_product(catalog_get(), idx, p);
+    printf("Updating %d: %s\n", p->code, p->name);
+    printf("New name (blank to keep): "); char tmp[128]; fgets(tmp, sizeof(tmp), stdin); trimnewline(tmp); if (strlen(tmp)) strncpy(p->name, tmp, sizeof(p->name)-1);
+    char in[32], cur[CENTS_CHARS]; int64_t d;
+    printf("New price (-1 to keep %s): ", cents_str(cur, p->price)); if (scanf("%31s", in)==1 && cents_parse(in, &d)) { if (d >= 0) p->price = d; } while(getchar()!='\n');
+    printf("New stock (-1 to keep %d): ", p->stock); int si; if (scanf("%d", &si)==1) { if (si >= 0 && si != p->stock) { int dlt = si - p->stock; catalog_apply_stock(idx, dlt); stock_journal_append(&idx, &dlt, 1); group_commit_flush(); } } while(getchar()!='\n');
+    printf("New discount (-1 to keep %s): ", cents_str(cur, p->discount)); if (scanf("%31s", in)==1 && cents_parse(in, &d)) { if (d >= 0) p->discount = (int)d; } while(getchar()!='\n');
+    printf("New category (blank to keep %s): ", p->category); fgets(tmp, sizeof(tmp), stdin); trimnewline(tmp); if (strlen(tmp)) strncpy(p->category, tmp, sizeof(p->category)-1);
+    printf("New subcategory (blank to keep %s): ", p->subcategory); fgets(tmp, sizeof(tmp), stdin); trimnewline(tmp); if (strlen(tmp)) strncpy(p->subcategory, tmp, sizeof(p->subcategory)-1);
+    printf("New reorder threshold (-1 to keep %d): ", p->reorderLevel); if (scanf("%d", &si)==1) { if (si >= 0) p->reorderLevel = si; } while(getchar()!='\n');
+    catalog_update(idx, p);
+    if (!catalog_write_record(idx)) printf("Save failed.\n"); else printf("Product updated.\n");
+}
+
+void admin_delete_product() {
+    if (catalog_get()->count == 0) { printf("No products.\n"); return; }
+    int code; printf("Enter product code to delete: "); if (scanf("%d", &code) != 1) { while(getchar()!='\n'); printf("Invalid.\n"); return; }
+    while(getchar()!='\n');
+    int idx = catalog_find(code);
+    if (idx == -1) { printf("Not found.\n"); return; }
+    catalog_delete(idx);
+    if (!catalog_save()) printf("Failed to save.\n"); else printf("Deleted.\n");
+}
+
+void admin_low_stock_alerts() {
+    Catalog *c = catalog_get();
+    int n = g_lowStock.count;
+    printf("\nLow-stock products (stock below reorder threshold):\n");
+    if (n == 0) { printf("No low-stock products.\n"); return; }
+    int *ids = xrealloc(NULL, sizeof(int) * n);
+    n = low_stock_list(ids, n);
+    for (int i = 0; i < n; ++i)
+        printf("%4d | % -20s | stock: %d | reorder at: %d\n",
+               c->code[ids[i]], catalog_name(c, ids[i]), c->stock[ids[i]], c->reorder[ids[i]]);
+    free(ids);
+}
+
+void admin_category_summary() {
+    Catalog *c = catalog_get();
+    if (c->count == 0) { printf("No products.\n"); return; }
+    int products = 0; long units = 0; Money value = 0;
+    char amt[CENTS_CHARS];
+    printf("+----------------------+----------+------------+----------------+\n");
+    printf("| Category             | Products | Units      | Stock Value    |\n");
+    printf("+----------------------+----------+------------+----------------+\n");
+    for (int id = 0; id < c->categories.count; ++id) {
+        const CategorySummary *s = category_summary(id);
+        if (!s || s->products == 0) continue;
+        printf("| %-20s | %8d | %10ld | %14s |\n", dict_str(&c->categories, id), s->products, s->units, cents_str(amt, s->value));
+        products += s->products; units += s->units; value += s->value;
+    }
+    printf("+----------------------+----------+------------+----------------+\n");
+    printf("| %-20s | %8d | %10ld | %14s |\n", "TOTAL", products, units, cents_str(amt, value));
+    printf("+----------------------+----------+------------+----------------+\n");
+}
+
+/* ---------- Billing functions (cashier) ---------- */
+
+void ensure_bills_dir() {
+    make_dir(BILLS_DIR);
+}
+
+/* Id allocator backed by a one-line counter file. A lane writing a bill
+   stores the counter before the bill; other checkouts leave it to their
+   group commit, which stores it after their receipt lines. Either way a
+   crash can only leave a gap or a counter behind the data, and lastId
+   (tail_last_id on the receipt log) recovers the highest id in use.
+   Stores only ever move the counter forward and replace the file whole,
+   so the group commit leader and a bill lane cannot lose ids. */
+typedef struct {
+    const char *seqFile;
+    int (*lastId)();
+    int last;
+    int loaded;
+    mutex_t lock;   // guards stored and the file
+    int stored;     // highest id in the file
+} IdSequence;
+
+static IdSequence g_receiptSeq = { RECEIPT_SEQ_FILE, receipt_log_last_id, 0, 0, MUTEX_INIT, 0 };
+
+/* Highest leading id among the lines in the tail of path, or 0. */
+static int tail_last_id(const char *path) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return 0;
+    char buf[SEQ_TAIL_BYTES + 1];
+    long long size = file_size(path), from = size > SEQ_TAIL_BYTES ? size - SEQ_TAIL_BYTES : 0;
+    size_t n = file_seek(fp, from) ? fread(buf, 1, SEQ_TAIL_BYTES, fp) : 0;
+    fclose(fp);
+    buf[n] = '\0';
+    int last = 0;
+    char *p = buf;
+    if (from > 0) {     // first line is probably cut
+        p = strchr(buf, '\n');
+        if (!p) return 0;
+        p++;
+    }
+    for (; *p; ) {
+        char *end;
+        long id = strtol(p, &end, 10);
+        if (end != p && *end == ',' && id > last && id <= INT_MAX) last = (int)id;
+        char *nl = strchr(p, '\n');
+        if (!nl) break;
+        p = nl + 1;
+    }
+    return last;
+}
+
+/* Hands out the next id without persisting the counter. */
+static int seq_take(IdSequence *s) {
+    if (!s->loaded) {
+        FILE *fp = fopen(s->seqFile, "r");
+        if (fp) { if (fscanf(fp, "%d", &s->last) != 1) s->last = 0; fclose(fp); }
+        s->stored = s->last;
+        int tail = s->lastId();
+        if (tail > s->last) s->last = tail;
+        s->loaded = 1;
+    }
+    return ++s->last;
+}
+
+/* Records id as used unless a higher one already is, via seqFile.tmp. */
+static void seq_store(IdSequence *s, int id) {
+    mutex_lock(&s->lock);
+    if (id > s->stored) {
+        char tmp[256];
+        snprintf(tmp, sizeof(tmp), "%s.tmp", s->seqFile);
+        FILE *fp = fopen(tmp, "w");
+        int ok = fp && fprintf(fp, "%d\n", id) > 0;
+        if (fp && fclose(fp) != 0) ok = 0;
+#ifdef _WIN32
+        if (ok) remove(s->seqFile);     // rename() does not replace on Windows
+#endif
+        if (ok && rename(tmp, s->seqFile) == 0) s->stored = id;
+        else printf("Warning: cannot update %s\n", s->seqFile);
+    }
+    mutex_unlock(&s->lock);
+}
+
+/* Persists the receipt counter for ids the group commit has written. */
+void receipt_seq_store(int id) {
+    seq_store(&g_receiptSeq, id);
+}
+
+/* Queues the receipt lines for the next group commit and returns how many
+   bytes they will add to receipts.txt. */
+size_t append_receipt_items(int rid, CartItem cart[], int cartCount, const char *customerName, const char *iso) {
+    TextBuf *b = &g_group.pending[GC_RECEIPTS];
+    size_t before = b->len;
+    char unit[CENTS_CHARS], amt[CENTS_CHARS];
+    for (int i = 0; i < cartCount; ++i) {
+        tb_printf(b, "%d,%s,%s,%d,%s,%d,%s,%s\n", rid, customerName, iso, cart[i].code, cart[i].name, cart[i].qty,
+                  cents_str(unit, cart[i].priceAfterDisc), cents_str(amt, cart[i].total));
+    }
+    receipt_index_add(rid, customerName, iso, b->len - before, cartCount);
+    return b->len - before;
+}
+
+/* Steady receipt line of c, formatted only when the line has changed. */
+static const char* cart_row(CartItem *c) {
+    if (!c->row[0]) {
+        char unit[CENTS_CHARS], amt[CENTS_CHARS];
+        snprintf(c->row, sizeof(c->row), "%-6d %-22s %5d %10s %10s\n", c->code, c->name, c->qty,
+                 cents_str(unit, c->priceAfterDisc), cents_str(amt, c->total));
+    }
+    return c->row;
+}
+
+void billing_print_steady(Lane *l) {
+    long long t0 = now_ns();
+    time_t t = time(NULL);
+    struct tm *lt = localtime(&t);
+    char iso[32]; strftime(iso, sizeof(iso), "%Y-%m-%d %H:%M:%S", lt);
 
     printf("\n-------------------- STEADY RECEIPT --------------------\n");
-    printf("Customer: %s\n", customerName);
+    printf("Customer: %s\n", l->customer);
     printf("Date: %s\n", iso);
     printf("--------------------------------------------------------\n");
     printf("%-6s %-22s %5s %10s %10s\n", "Code", "Item", "Qty", "Unit", "Subtotal");
     printf("--------------------------------------------------------\n");
-    double subtotal = 0.0;
-    for (int i = 0; i < cartCount; ++i) {
-        printf("%-6d %-22s %5d %10.2f %10.2f\n",
-               cart[i].code, cart[i].name, cart[i].qty, cart[i].priceAfterDisc, cart[i].total);
-        subtotal += cart[i].total;
-    }
+    for (int i = 0; i < l->cartCount; ++i) if (l->cart[i].qty) fputs(cart_row(&l->cart[i]), stdout);
     printf("--------------------------------------------------------\n");
-    double discount = 0.0;
-    double net = subtotal - discount;
-    printf("%52s %10.2f\n", "Subtotal:", subtotal);
-    printf("%52s %10.2f\n", "Discount:", discount);
-    printf("%52s %10.2f\n", "Net Total:", net);
+    char amt[CENTS_CHARS];
+    Money discount = 0;
+    Money net = l->subtotal - discount;
+    printf("%52s %10s\n", "Subtotal:", cents_str(amt, l->subtotal));
+    printf("%52s %10s\n", "Discount:", cents_str(amt, discount));
+    printf("%52s %10s\n", "Net Total:", cents_str(amt, net));
     printf("--------------------------------------------------------\n");
+    stats_time(STAGE_PRINT_STEADY, t0);
 }
 
-void billing_finalize_and_save(CartItem cart[], int cartCount, const char *customerName) {
-    if (cartCount == 0) { printf("Cart empty. Nothing to finalize.\n"); return; }
-    time_t t = time(NULL);
-    struct tm *lt = localtime(&t);
-    char iso[32]; strftime(iso, sizeof(iso), "%Y-%m-%d %H:%M:%S", lt);
-    double subtotal = 0.0;
-    for (int i = 0; i < cartCount; ++i) subtotal += cart[i].total;
-    double discount = 0.0;
-    double net = subtotal - discount;
+/* After a scan: the line for code as it now stands (nothing if it was
+   removed) and the running total, instead of the whole receipt. */
+void billing_print_line(Lane *l, int code) {
+    long long t0 = now_ns();
+    CartItem *c = lane_line(l, code);
+    if (c) fputs(cart_row(c), stdout);
+    char label[48], amt[CENTS_CHARS];
+    snprintf(label, sizeof(label), "Net Total (%d line%s):", l->live, l->live == 1 ? "" : "s");
+    printf("%52s %10s\n", label, cents_str(amt, l->subtotal));
+    stats_time(STAGE_PRINT_STEADY, t0);
+}
 
-    ensure_bills_dir();
-    char filename[256];
-    strftime(filename, sizeof(filename), BILLS_DIR "/bill_%Y%m%d_%H%M%S.txt", lt);
-    FILE *bf = fopen(filename, "w");
-    if (!bf) {
-        printf("Failed to create bill file. Showing on console only.\n");
+void billing_finalize_and_save(Lane *lane) {
+    if (lane->live == 0) { printf("Cart empty. Nothing to finalize.\n"); return; }
+    char billPath[256], amt[CENTS_CHARS];
+    Money net = lane_checkout(lane, billPath, sizeof(billPath));
+    if (billPath[0]) printf("Bill for receipt %d saved to: %s\n", lane->lastReceipt, billPath);
+    else printf("Failed to create bill file. Showing on console only.\n");
+    printf("Checkout complete. Net Total = %s\n", cents_str(amt, net));
+}
+
+/* ---------- Checkout lanes ---------- */
+/* Every open cart is a Lane. Adding an item reserves its units against the
+   shared catalog with stock_reserve(), which is lock-free, so any number of
+   lanes on different threads can sell from the same stock without
+   overselling; removing an item or cancelling hands the units back. Only
+   committing a finished bill takes g_commitLock. Products must not be
+   added, updated or deleted while lanes are running. */
+
+/* Unit price after a discount in hundredths of a percent, to the nearest
+   paisa. */
+static Money money_discounted(Money price, int discount) {
+    Money v = price * (10000 - discount);
+    return (v < 0 ? v - 5000 : v + 5000) / 10000;
+}
+
+/* Slot holding code's line, or the empty slot where it would go. A code
+   keeps its slot while its line is removed; re-adding it points the slot
+   at a new line. */
+static unsigned lane_slot(const Lane *l, int code) {
+    unsigned mask = (unsigned)l->cartCap * 2 - 1;
+    unsigned h = code_hash(code) & mask;
+    while (l->slot[h] >= 0 && l->cart[l->slot[h]].code != code) h = (h + 1) & mask;
+    return h;
+}
+
+static void lane_slots_rebuild(Lane *l) {
+    for (int i = 0; i < l->cartCap * 2; ++i) l->slot[i] = -1;
+    for (int i = 0; i < l->cartCount; ++i) l->slot[lane_slot(l, l->cart[i].code)] = i;
+}
+
+/* Drops removed lines, keeping the order of the rest. */
+static void lane_pack(Lane *l) {
+    if (l->live == l->cartCount) return;
+    int n = 0;
+    for (int i = 0; i < l->cartCount; ++i)
+        if (l->cart[i].qty) { if (n != i) l->cart[n] = l->cart[i]; n++; }
+    l->cartCount = n;
+    lane_slots_rebuild(l);
+}
+
+/* Makes room for one more line: packs if at least half the lines are
+   removed ones, otherwise doubles the arrays. */
+static void lane_grow(Lane *l) {
+    if (l->cartCount > 0 && (l->cartCount - l->live) * 2 >= l->cartCount) { lane_pack(l); return; }
+    l->cartCap = l->cartCap ? l->cartCap * 2 : 16;
+    l->cart = xrealloc(l->cart, sizeof(CartItem) * (size_t)l->cartCap);
+    l->slot = xrealloc(l->slot, sizeof(int) * 2 * (size_t)l->cartCap);
+    l->moved = xrealloc(l->moved, sizeof(int) * (size_t)l->cartCap);
+    l->delta = xrealloc(l->delta, sizeof(int) * (size_t)l->cartCap);
+    lane_slots_rebuild(l);
+}
+
+static int lane_add_item(Lane *l, int code, int qty) {
+    int pidx = catalog_find(code);
+    if (pidx < 0) return LANE_NO_PRODUCT;
+    if (qty <= 0) return LANE_BAD_QTY;
+    CartItem *c = lane_line(l, code);
+    if (!c && l->live == MAX_CART) return LANE_CART_FULL;
+    if (!stock_reserve(pidx, qty)) return LANE_NO_STOCK;
+    Catalog *cat = &g_catalog;
+    Money priceAfter = money_discounted(cat->price[pidx], cat->discount[pidx]);
+    if (c) {
+        c->qty += qty;
+        l->subtotal -= c->total;
     } else {
-        fprintf(bf, "==================== CODE_FUSION STORE BILL ====================\n");
-        fprintf(bf, "Date: %s\n", iso);
-        fprintf(bf, "Customer: %s\n", customerName);
-        fprintf(bf, "-----------------------------------------------------\n");
-        fprintf(bf, "%-6s %-22s %5s %10s %10s\n", "Code", "Item", "Qty", "Unit", "Subtotal");
-        fprintf(bf, "-----------------------------------------------------\n");
-        for (int i = 0; i < cartCount; ++i) {
-            fprintf(bf, "%-6d %-22s %5d %10.2f %10.2f\n",
-                    cart[i].code, cart[i].name, cart[i].qty, cart[i].priceAfterDisc, cart[i].total);
-        }
-        fprintf(bf, "-----------------------------------------------------\n");
-        fprintf(bf, "%52s %10.2f\n", "Subtotal:", subtotal);
-        fprintf(bf, "%52s %10.2f\n", "Discount:", discount);
-        fprintf(bf, "%52s %10.2f\n", "Net Total:", net);
-        fprintf(bf, "=====================================================\n");
-        fprintf(bf, " THANK YOU! VISIT AGAIN\n");
-        fprintf(bf, "=====================================================\n");
-        fclose(bf);
-        printf("Bill saved to: %s\n", filename);
-    }
-
-    append_receipt_items(cart, cartCount, customerName, iso);
-    append_sales_items(cart, cartCount, iso);
-
-    Product products[MAX_PRODUCTS]; int n = load_products(products, MAX_PRODUCTS);
-    for (int i = 0; i < cartCount; ++i) {
-        Product *p = find_product_by_code(products, n, cart[i].code);
-        if (p) {
-            p->stock -= cart[i].qty;
-            if (p->stock < 0) p->stock = 0;
+        if (l->cartCount == l->cartCap) lane_grow(l);
+        int at = l->cartCount++;
+        l->slot[lane_slot(l, code)] = at;
+        c = &l->cart[at];
+        c->code = code;
+        strncpy(c->name, catalog_name(cat, pidx), sizeof(c->name)-1);
+        c->name[sizeof(c->name)-1] = '\0';
+        c->qty = qty;
+        l->live++;
+    }
+    c->priceAfterDisc = priceAfter;
+    c->total = c->qty * priceAfter;
+    c->row[0] = '\0';
+    l->subtotal += c->total;
+    return LANE_OK;
+}
+
+/* The cart line for code, or NULL if it is not in the cart. */
+CartItem* lane_line(Lane *l, int code) {
+    if (l->cartCap == 0) return NULL;
+    int at = l->slot[lane_slot(l, code)];
+    return at >= 0 && l->cart[at].qty ? &l->cart[at] : NULL;
+}
+
+int lane_add(Lane *l, int code, int qty) {
+    long long t0 = now_ns();
+    int rc = lane_add_item(l, code, qty);
+    stats_time(STAGE_CART_ADD, t0);
+    return rc;
+}
+
+int lane_remove(Lane *l, int code) {
+    CartItem *c = lane_line(l, code);
+    if (!c) return 0;
+    int pidx = catalog_find(code);
+    if (pidx >= 0) stock_release(pidx, c->qty);
+    l->subtotal -= c->total;
+    c->qty = 0;
+    c->total = 0;
+    l->live--;
+    return 1;
+}
+
+/* Empties the cart without touching stock. Every used slot belongs to a
+   line's code; they are all found before any is cleared so no probe
+   sequence is cut short. */
+static void lane_clear(Lane *l) {
+    for (int i = 0; i < l->cartCount; ++i) l->moved[i] = (int)lane_slot(l, l->cart[i].code);
+    for (int i = 0; i < l->cartCount; ++i) l->slot[l->moved[i]] = -1;
+    l->cartCount = l->live = 0;
+    l->subtotal = 0;
+}
+
+void lane_cancel(Lane *l) {
+    for (int i = 0; i < l->cartCount; ++i) {
+        if (!l->cart[i].qty) continue;
+        int pidx = catalog_find(l->cart[i].code);
+        if (pidx >= 0) stock_release(pidx, l->cart[i].qty);
+    }
+    lane_clear(l);
+}
+
+void lane_free(Lane *l) {
+    free(l->cart); free(l->slot); free(l->moved); free(l->delta);
+    l->cart = NULL; l->slot = l->moved = l->delta = NULL;
+    l->cartCount = l->cartCap = l->live = 0;
+    l->subtotal = 0;
+}
+
+/* Turns the lane's reservations into stock movements in l->moved and
+   l->delta; returns how many products moved. Caller holds g_commitLock. */
+static int lane_commit_stock(Lane *l) {
+    int n = 0;
+    for (int i = 0; i < l->cartCount; ++i) {
+        int idx = catalog_find(l->cart[i].code);
+        if (idx < 0 || !l->cart[i].qty) continue;
+        int before = g_catalog.stock[idx];
+        l->moved[n] = idx;
+        l->delta[n++] = catalog_commit_reserved(idx, l->cart[i].qty) - before;
+    }
+    return n;
+}
+
+static BillArchive g_bills;
+static mutex_t g_billLock = MUTEX_INIT;    // g_bills; held from taking a billed receipt's id until its bill is out
+
+static void bill_archive_path(char *out, size_t n, int day) {
+    snprintf(out, n, BILLS_DIR "/%08d.bills", day);
+}
+
+static void bill_archive_close() {
+    if (g_bills.fp) fclose(g_bills.fp);
+    if (g_bills.idx) fclose(g_bills.idx);
+    g_bills.fp = g_bills.idx = NULL;
+}
+
+/* Opens the index and the archive for day, keeping both open between
+   bills. Index entries go after the last whole one, so a torn entry is
+   overwritten. Called with g_billLock held. */
+static int bill_archive_open(int day) {
+    if (!g_bills.idx) {
+        ensure_bills_dir();
+        long long size = file_size(BILL_INDEX_FILE);
+        g_bills.idx = fopen(BILL_INDEX_FILE, size < 0 ? "w+b" : "r+b");
+        if (!g_bills.idx) return 0;
+        if (size > 0 && !file_seek(g_bills.idx, size - size % (long long)sizeof(BillIndexEntry))) { bill_archive_close(); return 0; }
+    }
+    if (g_bills.fp && g_bills.day == day) return 1;
+    char path[256];
+    bill_archive_path(path, sizeof(path), day);
+    if (g_bills.fp) fclose(g_bills.fp);
+    g_bills.fp = fopen(path, "ab");
+    g_bills.day = day;
+    g_bills.size = file_size(path);
+    return g_bills.fp != NULL && g_bills.size >= 0;
+}
+
+/* Renders the bill into one buffer, appends it to the day's archive in a
+   single write and indexes it. path gets the archive's name. */
+static int write_bill_file(const Lane *l, int rid, const struct tm *lt, const char *iso,
+                           Money subtotal, Money discount, Money net, char *path, size_t pathLen) {
+    long long t0 = now_ns();
+    int day = (lt->tm_year + 1900) * 10000 + (lt->tm_mon + 1) * 100 + lt->tm_mday;
+    TextBuf *b = &g_bills.text;
+    b->len = 0;
+    tb_printf(b, "==================== CODE_FUSION STORE BILL ====================\n"
+                 "Receipt: %d\nDate: %s\nCustomer: %s\n"
+                 "-----------------------------------------------------\n"
+                 "%-6s %-22s %5s %10s %10s\n"
+                 "-----------------------------------------------------\n",
+              rid, iso, l->customer, "Code", "Item", "Qty", "Unit", "Subtotal");
+    char unit[CENTS_CHARS], amt[CENTS_CHARS], disc[CENTS_CHARS];
+    for (int i = 0; i < l->cartCount; ++i) {
+        tb_printf(b, "%-6d %-22s %5d %10s %10s\n", l->cart[i].code, l->cart[i].name, l->cart[i].qty,
+                  cents_str(unit, l->cart[i].priceAfterDisc), cents_str(amt, l->cart[i].total));
+    }
+    tb_printf(b, "-----------------------------------------------------\n"
+                 "%52s %10s\n%52s %10s\n%52s %10s\n"
+                 "=====================================================\n"
+                 " THANK YOU! VISIT AGAIN\n"
+                 "=====================================================\n",
+              "Subtotal:", cents_str(amt, subtotal), "Discount:", cents_str(disc, discount), "Net Total:", cents_str(unit, net));
+    if (path) path[0] = '\0';
+    if (!bill_archive_open(day)) return 0;
+    BillIndexEntry e = { rid, day, g_bills.size, (uint32_t)b->len, 0 };
+    // the bill goes out before its index entry, so an entry never points past its archive
+    int ok = fwrite(b->data, 1, b->len, g_bills.fp) == b->len && fflush(g_bills.fp) == 0
+             && fwrite(&e, sizeof(e), 1, g_bills.idx) == 1 && fflush(g_bills.idx) == 0;
+    if (!ok) { bill_archive_close(); return 0; }     // reopening finds the real sizes
+    g_bills.size += (long long)b->len;
+    if (path) bill_archive_path(path, pathLen, day);
+    stats_count(CTR_BYTES_BILLS, (long long)b->len);
+    stats_time(STAGE_BILL_WRITE, t0);
+    return 1;
+}
+
+/* Binary search of bills.idx on disk; receipt ids only grow, so its
+   entries are in id order. */
+static int bill_index_find(int rid, BillIndexEntry *out) {
+    FILE *fp = fopen(BILL_INDEX_FILE, "rb");
+    if (!fp) return 0;
+    long long lo = 0, hi = file_size(BILL_INDEX_FILE) / (long long)sizeof(BillIndexEntry);
+    int found = 0;
+    while (lo < hi && !found) {
+        long long mid = lo + (hi - lo) / 2;
+        if (!file_seek(fp, mid * (long long)sizeof(BillIndexEntry)) || fread(out, sizeof(*out), 1, fp) != 1) break;
+        if (out->rid < rid) lo = mid + 1;
+        else if (out->rid > rid) hi = mid;
+        else found = 1;
+    }
+    fclose(fp);
+    return found;
+}
+
+/* Prints the saved bill of receipt rid exactly as it was written. */
+int bill_reprint(int rid) {
+    BillIndexEntry e;
+    if (!bill_index_find(rid, &e)) { printf("No saved bill for receipt %d.\n", rid); return 0; }
+    char path[256];
+    bill_archive_path(path, sizeof(path), e.day);
+    FILE *fp = fopen(path, "rb");
+    char *buf = xrealloc(NULL, e.bytes ? e.bytes : 1);
+    int ok = fp && file_seek(fp, e.offset) && fread(buf, 1, e.bytes, fp) == e.bytes;
+    if (fp) fclose(fp);
+    if (ok) fwrite(buf, 1, e.bytes, stdout);
+    else printf("Cannot read the bill for receipt %d from %s.\n", rid, path);
+    free(buf);
+    return ok;
+}
+
+/* Commits the lane's cart: bill file (if l->writeBill), receipts, rollups
+   and the stock journal, the last three through the group commit. Leaves
+   the lane empty and returns the net total. */
+Money lane_checkout(Lane *l, char *billPath, size_t billPathLen) {
+    long long t0 = now_ns();
+    lane_pack(l);
+    Money subtotal = l->subtotal;
+    Money discount = 0;
+    Money net = subtotal - discount;
+
+    // billed ids are taken and their bills written in one g_billLock hold,
+    // so bills.idx stays in id order
+    if (l->writeBill) mutex_lock(&g_billLock);
+    mutex_lock(&g_commitLock);
+    time_t t = time(NULL);
+    struct tm tmv = *localtime(&t);
+    char iso[32]; strftime(iso, sizeof(iso), "%Y-%m-%d %H:%M:%S", &tmv);
+    int rid = seq_take(&g_receiptSeq);
+    g_group.lastReceipt = rid;
+    l->lastReceipt = rid;
+    if (billPath) billPath[0] = '\0';
+    if (l->writeBill) {
+        // the bill shows the id before its receipt lines are written, so the
+        // counter goes out first; without a bill it goes out with the batch.
+        // Other lanes keep committing meanwhile.
+        mutex_unlock(&g_commitLock);
+        receipt_seq_store(rid);
+        write_bill_file(l, rid, &tmv, iso, subtotal, discount, net, billPath, billPathLen);
+        mutex_unlock(&g_billLock);
+        mutex_lock(&g_commitLock);
+    }
+    long long tq = now_ns();
+    size_t bytes = append_receipt_items(rid, l->cart, l->cartCount, l->customer, iso);
+    rollups_record_checkout(l->cart, l->cartCount, (tmv.tm_year + 1900) * 10000 + (tmv.tm_mon + 1) * 100 + tmv.tm_mday, (long long)bytes);
+    int nMoved = lane_commit_stock(l);
+    stock_journal_append(l->moved, l->delta, nMoved);
+    stats_time(STAGE_COMMIT_QUEUE, tq);
+    long long tw = now_ns();
+    group_commit_locked();
+    stats_time(STAGE_COMMIT_WAIT, tw);
+    mutex_unlock(&g_commitLock);
+
+    lane_clear(l);
+    stats_time(STAGE_CHECKOUT, t0);
+    return net;
+}
+
+typedef struct {
+    int checkouts;
+    unsigned seed;
+    long long units;    // units in carts that reached checkout
+    int rejected;       // adds refused for lack of stock
+    int persist;        // commit through lane_checkout() instead of in memory
+    int id;
+} StressLane;
+
+static unsigned next_rand(unsigned *s) {
+    *s ^= *s << 13; *s ^= *s >> 17; *s ^= *s << 5;
+    return *s;
+}
+
+static void* stress_lane_run(void *arg) {
+    StressLane *s = arg;
+    Lane *l = xrealloc(NULL, sizeof(Lane));
+    memset(l, 0, sizeof(*l));
+    snprintf(l->customer, sizeof(l->customer), "Lane %d", s->id);
+    for (int i = 0; i < s->checkouts; ++i) {
+        int items = 1 + (int)(next_rand(&s->seed) % 5);
+        for (int j = 0; j < items; ++j) {
+            int code = g_catalog.code[next_rand(&s->seed) % (unsigned)g_catalog.count];
+            if (lane_add(l, code, 1 + (int)(next_rand(&s->seed) % 3)) == LANE_NO_STOCK) s->rejected++;
+        }
+        unsigned roll = next_rand(&s->seed) % 10;
+        if (roll == 0 && l->cartCount) lane_remove(l, l->cart[0].code);
+        if (roll == 1) { lane_cancel(l); continue; }
+        for (int j = 0; j < l->cartCount; ++j) s->units += l->cart[j].qty;
+        if (s->persist && l->live) { lane_checkout(l, NULL, 0); continue; }
+        lane_cancel(l);     // not saved: the reserved units go back
+    }
+    lane_free(l);
+    free(l);
+    return NULL;
+}
+
+/* Runs random carts on `lanes` threads against the catalog and checks that
+   no stock was oversold or lost. With persist set every cart is a real
+   checkout (receipts, rollups, journal) through the group commit, without
+   bill files; otherwise every cart is cancelled at checkout, so stock must
+   come back unchanged with nothing left reserved. */
+int stress_lanes(int lanes, int checkouts, int persist) {
+    Catalog *c = catalog_get();
+    if (c->count == 0 || lanes <= 0) { printf("Nothing to do.\n"); return 0; }
+    long long before = 0, after = 0, units = 0;
+    int rejected = 0;
+    for (int i = 0; i < c->count; ++i) before += c->stock[i];
+    StressLane *sl = xrealloc(NULL, sizeof(StressLane) * lanes);
+    thread_t *th = xrealloc(NULL, sizeof(thread_t) * lanes);
+    clock_t t0 = clock();
+    time_t w0 = time(NULL);
+    for (int i = 0; i < lanes; ++i) {
+        sl[i].checkouts = checkouts; sl[i].seed = 2463534242u + 977u * (unsigned)i; sl[i].units = 0; sl[i].rejected = 0;
+        sl[i].persist = persist; sl[i].id = i + 1;
+        if (!thread_start(&th[i], stress_lane_run, &sl[i])) { printf("Cannot start lane %d.\n", i); lanes = i; break; }
+    }
+    for (int i = 0; i < lanes; ++i) { thread_join(th[i]); units += sl[i].units; rejected += sl[i].rejected; }
+    group_commit_flush();
+    int bad = 0;
+    for (int i = 0; i < c->count; ++i) {
+        after += c->stock[i];
+        if (c->stock[i] < 0 || stock_available(i) != c->stock[i]) bad++;
+    }
+    long long sold = persist ? units : 0;
+    printf("lanes %d | checkouts/lane %d | units %s %lld | adds refused %d | cpu %.2fs wall %lds\n",
+           lanes, checkouts, persist ? "sold" : "carted", units, rejected, (double)(clock() - t0) / CLOCKS_PER_SEC, (long)(time(NULL) - w0));
+    printf("stock before %lld, after %lld, sold %lld: %s; products with bad reservations: %d\n",
+           before, after, sold, before - after == sold ? "consistent" : "MISMATCH", bad);
+    group_commit_report();
+    free(sl); free(th);
+    return before - after == sold && bad == 0;
+}
+
+/* ---------- Batch checkout ---------- */
+/* Replays a transaction stream, one checkout per line:
+       customer,code,qty[,code,qty...]
+   Lines are handed out to `lanes` worker threads, each running them
+   through lane_add()/lane_checkout() like the cashier menu does. */
+
+#define BATCH_MAX_WARNINGS 10
+
+typedef struct {
+    CsvReader in;
+    mutex_t lock;       // guards in, line and warnings
+    long long line;
+    int warnings;
+    int writeBills;
+} BatchSource;
+
+typedef struct {
+    BatchSource *src;
+    long long txns, committed, empty, items, units;
+    long long noProduct, noStock, badQty, cartFull;
+    Money net;
+    double *latency;    // seconds per committed transaction
+    long long latencyCap;
+} BatchLane;
+
+typedef struct {
+    char customer[128];
+    int *code, *qty;
+    int n, cap;
+    long long line;
+} BatchTxn;
+
+static void batch_warn(BatchSource *src, long long line, const char *what) {
+    if (src->warnings++ < BATCH_MAX_WARNINGS) printf("line %lld: %s\n", line, what);
+}
+
+/* Takes the next transaction off the stream; 0 at end of input. */
+static int batch_read(BatchSource *src, BatchTxn *t) {
+    mutex_lock(&src->lock);
+    int got = 0;
+    while (!got && csv_next(&src->in, 2) > 0) {
+        long long line = ++src->line;
+        if (src->in.nf < 2) { batch_warn(src, line, "no items"); continue; }
+        field_copy(src->in.f[0], t->customer, sizeof(t->customer));
+        if (!t->customer[0]) strcpy(t->customer, "Walk-in");
+        t->n = 0;
+        t->line = line;
+        const char *p = src->in.f[1].p, *e = p + src->in.f[1].len;
+        int ok = 1;
+        while (p < e && ok) {
+            Field f[2];
+            for (int k = 0; k < 2; ++k) {
+                const char *q = p < e ? memchr(p, ',', (size_t)(e - p)) : NULL;
+                if (!q) q = e;
+                f[k].p = p; f[k].len = (int)(q - p);
+                p = q < e ? q + 1 : e;
+            }
+            if (t->n == MAX_CART) { batch_warn(src, line, "too many items, rest ignored"); break; }
+            if (t->n == t->cap) {
+                t->cap = t->cap ? t->cap * 2 : 64;
+                t->code = xrealloc(t->code, sizeof(int) * (size_t)t->cap);
+                t->qty = xrealloc(t->qty, sizeof(int) * (size_t)t->cap);
+            }
+            ok = field_int(f[0], &t->code[t->n]) && field_int(f[1], &t->qty[t->n]);
+            if (ok) t->n++;
+        }
+        if (!ok) { batch_warn(src, line, "expected code,qty pairs"); continue; }
+        got = 1;
+    }
+    mutex_unlock(&src->lock);
+    return got;
+}
+
+static void* batch_lane_run(void *arg) {
+    BatchLane *b = arg;
+    Lane *l = xrealloc(NULL, sizeof(Lane));
+    memset(l, 0, sizeof(*l));
+    l->writeBill = b->src->writeBills;
+    BatchTxn t;
+    memset(&t, 0, sizeof(t));
+    char billPath[256];
+    while (batch_read(b->src, &t)) {
+        double t0 = now_seconds();
+        b->txns++;
+        strcpy(l->customer, t.customer);
+        for (int i = 0; i < t.n; ++i) {
+            switch (lane_add(l, t.code[i], t.qty[i])) {
+                case LANE_OK: b->items++; break;
+                case LANE_NO_PRODUCT: b->noProduct++; break;
+                case LANE_NO_STOCK: b->noStock++; break;
+                case LANE_BAD_QTY: b->badQty++; break;
+                case LANE_CART_FULL: b->cartFull++; break;
+            }
+        }
+        if (l->live == 0) { b->empty++; continue; }
+        for (int i = 0; i < l->cartCount; ++i) b->units += l->cart[i].qty;
+        b->net += lane_checkout(l, billPath, sizeof(billPath));
+        if (b->committed == b->latencyCap) {
+            b->latencyCap = b->latencyCap ? b->latencyCap * 2 : 1024;
+            b->latency = xrealloc(b->latency, sizeof(double) * (size_t)b->latencyCap);
         }
+        b->latency[b->committed++] = now_seconds() - t0;
     }
-    if (!save_products(products, n)) printf("Warning: could not update products file after sale.\n");
+    free(t.code); free(t.qty);
+    lane_free(l);
+    free(l);
+    return NULL;
+}
+
+static int double_cmp(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
 
-    printf("Checkout complete. Net Total = %.2f\n", net);
+/* Runs the transaction stream at path ("-" for stdin) through `lanes`
+   concurrent checkout lanes and prints throughput and latency. */
+int batch_checkout(const char *path, int lanes, int writeBills) {
+    Catalog *c = catalog_get();
+    if (c->count == 0) { printf("No products available.\n"); return 0; }
+    if (lanes <= 0) lanes = 1;
+    BatchSource src;
+    memset(&src, 0, sizeof(src));
+    if (!csv_open(&src.in, path)) { printf("Cannot open %s\n", path); return 0; }
+    static const mutex_t unlocked = MUTEX_INIT;
+    src.lock = unlocked;
+    src.writeBills = writeBills;
+    if (writeBills) ensure_bills_dir();
+    BatchLane *bl = xrealloc(NULL, sizeof(BatchLane) * lanes);
+    thread_t *th = xrealloc(NULL, sizeof(thread_t) * lanes);
+    memset(bl, 0, sizeof(BatchLane) * lanes);
+    double w0 = now_seconds();
+    int started = 0;
+    for (; started < lanes; ++started) {
+        bl[started].src = &src;
+        if (!thread_start(&th[started], batch_lane_run, &bl[started])) { printf("Cannot start lane %d.\n", started); break; }
+    }
+    for (int i = 0; i < started; ++i) thread_join(th[i]);
+    if (started == 0) { bl[0].src = &src; batch_lane_run(&bl[0]); started = 1; }   // no threads: run inline
+    group_commit_flush();
+    BatchLane sum;
+    memset(&sum, 0, sizeof(sum));
+    double wall = now_seconds() - w0;
+    csv_close(&src.in);
+    for (int i = 0; i < started; ++i) {
+        BatchLane *b = &bl[i];
+        sum.txns += b->txns; sum.committed += b->committed; sum.empty += b->empty;
+        sum.items += b->items; sum.units += b->units; sum.net += b->net;
+        sum.noProduct += b->noProduct; sum.noStock += b->noStock; sum.badQty += b->badQty; sum.cartFull += b->cartFull;
+    }
+    double *lat = xrealloc(NULL, sizeof(double) * (size_t)(sum.committed ? sum.committed : 1));
+    long long n = 0;
+    for (int i = 0; i < started; ++i) {
+        memcpy(lat + n, bl[i].latency, sizeof(double) * (size_t)bl[i].committed);
+        n += bl[i].committed;
+        free(bl[i].latency);
+    }
+    if (src.warnings > BATCH_MAX_WARNINGS) printf("... %d more bad lines\n", src.warnings - BATCH_MAX_WARNINGS);
+    char amt[CENTS_CHARS];
+    printf("batch: %lld lines, %lld transactions, %lld committed, %lld empty | %lld items, %lld units, net %s\n",
+           src.line, sum.txns, sum.committed, sum.empty, sum.items, sum.units, cents_str(amt, sum.net));
+    printf("refused items: %lld unknown product, %lld out of stock, %lld bad qty, %lld cart full\n",
+           sum.noProduct, sum.noStock, sum.badQty, sum.cartFull);
+    printf("lanes %d | wall %.3fs | %.0f checkouts/s\n", started, wall, wall > 0 ? sum.committed / wall : 0.0);
+    if (n > 0) {
+        qsort(lat, (size_t)n, sizeof(double), double_cmp);
+        double mean = 0;
+        for (long long i = 0; i < n; ++i) mean += lat[i];
+        printf("latency us: mean %.0f | p50 %.0f | p90 %.0f | p99 %.0f | p99.9 %.0f | max %.0f\n",
+               mean / n * 1e6, lat[n / 2] * 1e6, lat[n * 9 / 10] * 1e6, lat[n * 99 / 100] * 1e6,
+               lat[n * 999 / 1000] * 1e6, lat[n - 1] * 1e6);
+    }
+    group_commit_report();
+    stats_print(stdout);
+    free(lat); free(bl); free(th);
+    return 1;
 }
 
 void billing_menu() {
-    Product products[MAX_PRODUCTS];
-    int prodCount = load_products(products, MAX_PRODUCTS);
-    if (prodCount == 0) {
+    Catalog *cat = catalog_get();
+    if (cat->count == 0) {
         printf("No products available. Ask admin to add products first.\n");
         return;
     }
 
-    CartItem cart[MAX_CART];
-    int cartCount = 0;
-    char customerName[128];
+    static Lane lane;
+    lane_cancel(&lane);
+    lane.writeBill = 1;
     printf("Billing mode - enter customer name (or 'walkin'): ");
-    fgets(customerName, sizeof(customerName), stdin); trimnewline(customerName);
-    if (strlen(customerName) == 0) strcpy(customerName, "Walk-in");
+    fgets(lane.customer, sizeof(lane.customer), stdin); trimnewline(lane.customer);
+    if (strlen(lane.customer) == 0) strcpy(lane.customer, "Walk-in");
 
     while (1) {
         printf("\n==== BILLING SECTION(Cashier) ====\n");
@@ -470,6 +3501,7 @@ void billing_menu() {
         printf("4. Remove Item from Cart\n");
         printf("5. View Steady Receipt\n");
         printf("6. Finalize / Save Bill\n");
+        printf("7. Reprint Bill\n");
         printf("0. Cancel & Back\n");
         printf("Enter choice: ");
         int ch;
@@ -477,38 +3509,37 @@ void billing_menu() {
         while (getchar()!='\n');
 
         if (ch == 0) {
+            lane_cancel(&lane);
             printf("Exiting billing. Any unsaved cart will be lost.\n");
             return;
         }
         else if (ch == 1) {
-            prodCount = load_products(products, MAX_PRODUCTS);
+            char price[CENTS_CHARS], disc[CENTS_CHARS];
             printf("\nCode | Name | Price | Stock | Disc\n");
             printf("-------------------------------------------\n");
-            for (int i = 0; i < prodCount; ++i) {
-                printf("%4d | % -25s | %7.2f | %4d | %4.1f%%\n",
-                       products[i].code, products[i].name, products[i].price, products[i].stock, products[i].discount);
+            for (int i = 0; i < cat->count; ++i) {
+                printf("%4d | % -25s | %7s | %4d | %5s%%\n", cat->code[i], catalog_name(cat, i),
+                       cents_str(price, cat->price[i]), stock_available(i), cents_str(disc, cat->discount[i]));
             }
             pause_console();
         }
         else if (ch == 2) {
-            char term[128]; printf("Enter product id or name: ");
+            char term[128], price[CENTS_CHARS]; printf("Enter product id or name: ");
             fgets(term, sizeof(term), stdin); trimnewline(term);
             int all_digits = 1; for (size_t i=0;i<strlen(term);++i) if (!isdigit((unsigned char)term[i])) { all_digits = 0; break; }
             if (all_digits && strlen(term)>0) {
                 int id = atoi(term);
-                Product *p = find_product_by_code(products, prodCount, id);
-                if (p) printf("Found: %d | %s | %.2f | stock %d\n", p->code, p->name, p->price, p->stock);
+                int idx = catalog_find(id);
+                if (idx >= 0) printf("Found: %d | %s | %s | stock %d\n", cat->code[idx], catalog_name(cat, idx), cents_str(price, cat->price[idx]), stock_available(idx));
                 else printf("Not found.\n");
             } else {
-                char lower[128]; strncpy(lower, term, sizeof(lower)); strtolower(lower);
-                int found = 0;
-                for (int i=0;i<prodCount;++i) {
-                    char nameLower[128]; strncpy(nameLower, products[i].name, sizeof(nameLower)); strtolower(nameLower);
-                    if (strstr(nameLower, lower)) {
-                        printf("%d | %s | %.2f | stock %d\n", products[i].code, products[i].name, products[i].price, products[i].stock);
-                        found = 1;
-                    }
+                int hits[SEARCH_MAX_RESULTS];
+                int found = name_index_search(term, hits, SEARCH_MAX_RESULTS);
+                for (int i = 0; i < found && i < SEARCH_MAX_RESULTS; ++i) {
+                    int k = hits[i];
+                    printf("%d | %s | %s | stock %d\n", cat->code[k], catalog_name(cat, k), cents_str(price, cat->price[k]), stock_available(k));
                 }
+                if (found > SEARCH_MAX_RESULTS) printf("... %d more matches, refine the search.\n", found - SEARCH_MAX_RESULTS);
                 if (!found) printf("No matches.\n");
             }
             pause_console();
@@ -520,63 +3551,1116 @@ void billing_menu() {
             printf("Enter quantity: ");
             if (scanf("%d", &qty) != 1) { while(getchar()!='\n'); printf("Invalid.\n"); continue;}
             while(getchar()!='\n');
-            Product *p = find_product_by_code(products, prodCount, code);
-            if (!p) { printf("Product not found.\n"); continue; }
-            if (qty <= 0) { printf("Quantity must be positive.\n"); continue; }
-            if (p->stock < qty) { printf("Insufficient stock (available %d).\n", p->stock); continue; }
-            double priceAfter = p->price * (100.0 - p->discount) / 100.0;
-            double subtotal = priceAfter * qty;
-            int foundIdx = -1;
-            for (int i = 0; i < cartCount; ++i) if (cart[i].code == code) { foundIdx = i; break; }
-            if (foundIdx >= 0) {
-                cart[foundIdx].qty += qty;
-                cart[foundIdx].priceAfterDisc = priceAfter;
-                cart[foundIdx].total = cart[foundIdx].qty * cart[foundIdx].priceAfterDisc;
-            } else {
-                if (cartCount < MAX_CART) {
-                    cart[cartCount].code = code;
-                    strncpy(cart[cartCount].name, p->name, sizeof(cart[cartCount].name));
-                    cart[cartCount].qty = qty;
-                    cart[cartCount].priceAfterDisc = priceAfter;
-                    cart[cartCount].total = subtotal;
-                    cartCount++;
-                } else {
-                    printf("Cart full.\n");
-                }
+            int pidx = catalog_find(code);
+            switch (lane_add(&lane, code, qty)) {
+                case LANE_NO_PRODUCT: printf("Product not found.\n"); continue;
+                case LANE_BAD_QTY: printf("Quantity must be positive.\n"); continue;
+                case LANE_NO_STOCK: printf("Insufficient stock (available %d).\n", stock_available(pidx)); continue;
+                case LANE_CART_FULL: printf("Cart full.\n"); continue;
             }
-            billing_print_steady(cart, cartCount, customerName);
+            billing_print_line(&lane, code);
         }
         else if (ch == 4) {
             int code; printf("Enter product code to remove from cart: ");
             if (scanf("%d", &code) != 1) { while(getchar()!='\n'); printf("Invalid.\n"); continue;}
             while(getchar()!='\n');
-            int idx = -1;
-            for (int i = 0; i < cartCount; ++i) if (cart[i].code == code) { idx = i; break; }
-            if (idx == -1) { printf("Not in cart.\n"); continue; }
-            for (int i = idx; i < cartCount-1; ++i) cart[i] = cart[i+1];
-            cartCount--;
+            if (!lane_remove(&lane, code)) { printf("Not in cart.\n"); continue; }
             printf("Removed from cart.\n");
-            billing_print_steady(cart, cartCount, customerName);
+            billing_print_line(&lane, code);
         }
         else if (ch == 5) {
-            billing_print_steady(cart, cartCount, customerName);
+            billing_print_steady(&lane);
             pause_console();
         }
         else if (ch == 6) {
-            billing_finalize_and_save(cart, cartCount, customerName);
-            cartCount = 0;
+            billing_finalize_and_save(&lane);
             pause_console();
             return;
         }
+        else if (ch == 7) {
+            int rid; printf("Enter receipt ID: ");
+            if (scanf("%d", &rid) != 1) { while(getchar()!='\n'); printf("Invalid.\n"); continue;}
+            while(getchar()!='\n');
+            bill_reprint(rid);
+            pause_console();
+        }
         else {
             printf("Invalid.\n");
         }
     }
 }
 
+/* One receipts.txt line: rid,customer,iso,code,name,qty,unit,subtotal.
+   The string fields point into the reader's buffer. */
+typedef struct {
+    int rid, code, qty;
+    Field customer, iso, name;
+    Money unit, subtotal;
+} ReceiptLine;
+
+static int receipt_parse(const CsvReader *r, ReceiptLine *x) {
+    if (r->nf < 8) return 0;
+    x->customer = r->f[1]; x->iso = r->f[2]; x->name = r->f[4];
+    return field_int(r->f[0], &x->rid) && field_int(r->f[3], &x->code) && field_int(r->f[5], &x->qty)
+        && field_cents(r->f[6], &x->unit) && field_cents(r->f[7], &x->subtotal);
+}
+
+static int two_digits(const char *p) {
+    if (p[0] < '0' || p[0] > '9' || p[1] < '0' || p[1] > '9') return -1;
+    return (p[0] - '0') * 10 + (p[1] - '0');
+}
+
+/* "YYYY-MM-DD HH:MM:SS" -> day key YYYYMMDD and seconds since midnight. */
+static int iso_parse(Field f, int *day, int *tod) {
+    if (f.len < 10 || f.p[4] != '-' || f.p[7] != '-') return 0;
+    int y1 = two_digits(f.p), y2 = two_digits(f.p + 2), mo = two_digits(f.p + 5), d = two_digits(f.p + 8);
+    if (y1 < 0 || y2 < 0 || mo < 0 || d < 0) return 0;
+    *day = (y1 * 100 + y2) * 10000 + mo * 100 + d;
+    *tod = 0;
+    if (f.len >= 19) {
+        int h = two_digits(f.p + 11), mi = two_digits(f.p + 14), se = two_digits(f.p + 17);
+        if (h >= 0 && mi >= 0 && se >= 0) *tod = h * 3600 + mi * 60 + se;
+    }
+    return 1;
+}
+
+/* Turns a date prefix "YYYY", "YYYY-MM" or "YYYY-MM-DD" into an inclusive
+   range of day keys. */
+static int date_range(const char *s, int *lo, int *hi) {
+    size_t n = strlen(s);
+    int y1 = n >= 4 ? two_digits(s) : -1, y2 = n >= 4 ? two_digits(s + 2) : -1;
+    if (y1 < 0 || y2 < 0) return 0;
+    int y = y1 * 100 + y2;
+    if (n == 4) { *lo = y * 10000 + 101; *hi = y * 10000 + 1231; return 1; }
+    int mo = n >= 7 && s[4] == '-' ? two_digits(s + 5) : -1;
+    if (mo < 0) return 0;
+    if (n == 7) { *lo = y * 10000 + mo * 100 + 1; *hi = y * 10000 + mo * 100 + 31; return 1; }
+    int d = n == 10 && s[7] == '-' ? two_digits(s + 8) : -1;
+    if (d < 0) return 0;
+    *lo = *hi = y * 10000 + mo * 100 + d;
+    return 1;
+}
+
+/* ---------- Receipt segments ---------- */
+
+static ReceiptLog g_receiptLog;
+
+static void receipt_seg_path(char *out, size_t n, long long base) {
+    snprintf(out, n, "%s/%012lld.txt", RECEIPT_SEG_DIR, base);
+}
+
+static void receipt_zone_init(ReceiptZone *z) {
+    memset(z, 0, sizeof(*z));
+    z->minDay = z->minRid = INT_MAX;
+}
+
+static void receipt_zone_fold(ReceiptZone *z, const ReceiptZone *o) {
+    if (o->minDay < z->minDay) z->minDay = o->minDay;
+    if (o->maxDay > z->maxDay) z->maxDay = o->maxDay;
+    if (o->minRid < z->minRid) z->minRid = o->minRid;
+    if (o->maxRid > z->maxRid) z->maxRid = o->maxRid;
+    z->lines += o->lines;
+    z->bytes += o->bytes;
+    for (size_t i = 0; i < sizeof(z->codes); ++i) z->codes[i] |= o->codes[i];
+}
+
+/* Whether z may hold lines dated within [fromDay, toDay] (0 leaving that
+   end open) selling code (-1 for any). */
+static int receipt_zone_may_match(const ReceiptZone *z, int fromDay, int toDay, int code) {
+    if ((fromDay && z->maxDay < fromDay) || (toDay && z->minDay > toDay)) return 0;
+    return code < 0 || (z->codes[(uint32_t)code % ZONE_CODE_BITS / 8] >> ((uint32_t)code % 8) & 1);
+}
+
+/* Scan kernel: one chunk into zone 1 + chunk of the array at arg; the
+   merge folds it into zone 0. */
+static int receipt_zone_scan_chunk(CsvReader *r, long long end, int chunk, void *arg) {
+    ReceiptZone *z = (ReceiptZone *)arg + 1 + chunk;
+    ReceiptLine x;
+    int day, tod;
+    while (csv_tell(r) < end && csv_next(r, CSV_MAX_FIELDS) > 0) {
+        if (!receipt_parse(r, &x) || !iso_parse(x.iso, &day, &tod)) continue;
+        if (day < z->minDay) z->minDay = day;
+        if (day > z->maxDay) z->maxDay = day;
+        if (x.rid < z->minRid) z->minRid = x.rid;
+        if (x.rid > z->maxRid) z->maxRid = x.rid;
+        z->codes[(uint32_t)x.code % ZONE_CODE_BITS / 8] |= (uint8_t)(1u << ((uint32_t)x.code % 8));
+        z->lines++;
+    }
+    return 1;
+}
+
+static int receipt_zone_scan_merge(int chunk, int ok, void *arg) {
+    if (ok) receipt_zone_fold((ReceiptZone *)arg, (ReceiptZone *)arg + 1 + chunk);
+    return 1;
+}
+
+/* Zone map of the bytes bytes of path, which start at log offset base. */
+static int receipt_zone_scan(const char *path, long long base, long long bytes, ReceiptZone *out) {
+    ScanFile f;
+    snprintf(f.path, sizeof(f.path), "%s", path);
+    f.base = base;
+    f.size = bytes;
+    ParallelScan s;
+    if (!scan_split(&s, &f, 1, base, base + bytes)) return 0;
+    ReceiptZone *parts = xrealloc(NULL, sizeof(ReceiptZone) * ((size_t)s.chunks + 1));
+    for (int i = 0; i <= s.chunks; ++i) receipt_zone_init(&parts[i]);
+    int ok = scan_run(&s, receipt_zone_scan_chunk, receipt_zone_scan_merge, parts);
+    *out = parts[0];
+    out->base = base;
+    out->bytes = bytes;
+    free(parts);
+    scan_free(&s);
+    return ok;
+}
+
+static ReceiptZone* receipt_zone_push(ReceiptLog *lg) {
+    if (lg->count == lg->cap) {
+        lg->cap = lg->cap ? lg->cap * 2 : 16;
+        lg->zone = xrealloc(lg->zone, sizeof(ReceiptZone) * lg->cap);
+    }
+    return &lg->zone[lg->count++];
+}
+
+/* Rewrites segments.dat, via segments.dat.tmp. */
+static int receipt_log_save() {
+    const char *tmp = RECEIPT_SEG_MANIFEST ".tmp";
+    FILE *fp = fopen(tmp, "wb");
+    if (!fp) return 0;
+    ReceiptSegHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, RECEIPT_SEG_MAGIC, sizeof(RECEIPT_SEG_MAGIC));
+    h.version = RECEIPT_SEG_VERSION;
+    h.recordSize = sizeof(ReceiptZone);
+    h.count = (uint32_t)g_receiptLog.count;
+    int ok = fwrite(&h, sizeof(h), 1, fp) == 1
+             && fwrite(g_receiptLog.zone, sizeof(ReceiptZone), (size_t)h.count, fp) == h.count;
+    if (!sync_file(fp)) ok = 0;
+    if (fclose(fp) != 0) ok = 0;
+    if (!ok) { remove(tmp); return 0; }
+#ifdef _WIN32
+    remove(RECEIPT_SEG_MANIFEST);
+#endif
+    return rename(tmp, RECEIPT_SEG_MANIFEST) == 0;
+}
+
+/* Reads segments.dat once. The files themselves are the truth: zones are
+   kept up to the first whose file is missing or has another size, and the
+   chain is then followed from there, each segment starting where the last
+   ended, scanning zones for segments the manifest does not list (a
+   rotation or compaction cut short, or a lost manifest). A torn last line
+   of receipts.txt is dropped first: the sales store, rollups and receipt
+   index stop before it, so appending after it would put every later
+   receipt past the offsets they record. */
+ReceiptLog* receipt_log_get() {
+    ReceiptLog *lg = &g_receiptLog;
+    if (lg->loaded) return lg;
+    lg->loaded = 1;
+    if (!file_drop_torn_tail(RECEIPTS_FILE)) printf("Warning: cannot drop the torn last line of %s\n", RECEIPTS_FILE);
+    char path[64];
+    int listed = 0;
+    FILE *fp = fopen(RECEIPT_SEG_MANIFEST, "rb");
+    if (fp) {
+        ReceiptSegHeader h;
+        int ok = fread(&h, sizeof(h), 1, fp) == 1 && memcmp(h.magic, RECEIPT_SEG_MAGIC, sizeof(RECEIPT_SEG_MAGIC)) == 0
+                 && h.version == RECEIPT_SEG_VERSION && h.recordSize == sizeof(ReceiptZone);
+        for (uint32_t i = 0; ok && i < h.count; ++i) {
+            ReceiptZone *z = receipt_zone_push(lg);
+            receipt_seg_path(path, sizeof(path), lg->sealedBytes);
+            ok = fread(z, sizeof(*z), 1, fp) == 1 && z->base == lg->sealedBytes && z->bytes > 0
+                 && file_size(path) == z->bytes;
+            if (ok) lg->sealedBytes += z->bytes;
+            else lg->count--;
+        }
+        fclose(fp);
+        listed = lg->count;
+    }
+    long long bytes;
+    ReceiptZone z;
+    for (receipt_seg_path(path, sizeof(path), lg->sealedBytes); (bytes = file_size(path)) > 0;
+         receipt_seg_path(path, sizeof(path), lg->sealedBytes)) {
+        if (!receipt_zone_scan(path, lg->sealedBytes, bytes, &z)) { printf("Cannot read %s.\n", path); break; }
+        *receipt_zone_push(lg) = z;
+        lg->sealedBytes += bytes;
+    }
+    if (lg->count != listed && !receipt_log_save()) printf("Warning: cannot update %s\n", RECEIPT_SEG_MANIFEST);
+    return lg;
+}
+
+/* Bytes in the receipt log, or -1 if there are no receipts at all. */
+long long receipt_log_size() {
+    ReceiptLog *lg = receipt_log_get();
+    long long active = file_size(RECEIPTS_FILE);
+    if (active < 0 && lg->count == 0) return -1;
+    return lg->sealedBytes + (active > 0 ? active : 0);
+}
+
+/* Splits log offsets [from, to) for a parallel scan over the segments,
+   leaving out sealed segments for which keep (if given) returns 0. */
+static int receipt_log_split(ParallelScan *s, long long from, long long to,
+                             int (*keep)(const ReceiptZone *z, void *ctx), void *ctx) {
+    ReceiptLog *lg = receipt_log_get();
+    ScanFile *f = xrealloc(NULL, sizeof(ScanFile) * ((size_t)lg->count + 1));
+    int n = 0;
+    for (int i = 0; i < lg->count; ++i) {
+        const ReceiptZone *z = &lg->zone[i];
+        if (z->base + z->bytes <= from || z->base >= to || (keep && !keep(z, ctx))) continue;
+        receipt_seg_path(f[n].path, sizeof(f[n].path), z->base);
+        f[n].base = z->base;
+        f[n++].size = z->bytes;
+    }
+    long long active = file_size(RECEIPTS_FILE);
+    if (active > 0) {
+        snprintf(f[n].path, sizeof(f[n].path), "%s", RECEIPTS_FILE);
+        f[n].base = lg->sealedBytes;
+        f[n++].size = active;
+    }
+    int ok = scan_split(s, f, n, from, to);
+    free(f);
+    return ok;
+}
+
+/* Loads log offsets [off, off + len) into r like csv_read_at(). *seg is
+   the segment r has open: -1 for none, count for receipts.txt. */
+static int receipt_log_read_at(CsvReader *r, int *seg, long long off, size_t len) {
+    ReceiptLog *lg = receipt_log_get();
+    int lo = 0, hi = lg->count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (lg->zone[mid].base + lg->zone[mid].bytes <= off) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo != *seg) {
+        char path[64];
+        if (*seg >= 0) csv_close(r);
+        if (lo < lg->count) receipt_seg_path(path, sizeof(path), lg->zone[lo].base);
+        else snprintf(path, sizeof(path), "%s", RECEIPTS_FILE);
+        *seg = csv_open(r, path) ? lo : -1;
+        if (*seg < 0) return 0;
+    }
+    long long base = lo < lg->count ? lg->zone[lo].base : lg->sealedBytes;
+    if (!csv_read_at(r, off - base, len)) return 0;
+    r->base = off;
+    return 1;
+}
+
+/* Day of the first line of path, or 0. */
+static int receipt_first_day(const char *path) {
+    CsvReader r;
+    ReceiptLine x;
+    int day = 0, tod;
+    if (!csv_open(&r, path)) return 0;
+    if (csv_next(&r, CSV_MAX_FIELDS) > 0 && receipt_parse(&r, &x)) iso_parse(x.iso, &day, &tod);
+    csv_close(&r);
+    return day;
+}
+
+/* Moves receipts.txt (size bytes) to the end of the sealed segments. */
+static int receipt_log_seal(long long size) {
+    ReceiptLog *lg = receipt_log_get();
+    char path[64];
+    ReceiptZone z;
+    receipt_seg_path(path, sizeof(path), lg->sealedBytes);
+    if (!make_dir(RECEIPT_SEG_DIR) || !receipt_zone_scan(RECEIPTS_FILE, lg->sealedBytes, size, &z)) return 0;
+    if (rename(RECEIPTS_FILE, path) != 0) return 0;
+    *receipt_zone_push(lg) = z;
+    lg->sealedBytes += size;
+    if (!receipt_log_save()) printf("Warning: cannot update %s\n", RECEIPT_SEG_MANIFEST);
+    return 1;
+}
+
+/* Called by the group commit leader before it appends a batch of receipt
+   lines: seals receipts.txt if the batch starts a new day or would take it
+   past RECEIPT_SEG_MAX_BYTES. */
+void receipt_log_maybe_rotate(const char *incoming, size_t len) {
+    ReceiptLog *lg = receipt_log_get();
+    const char *e = incoming + len, *p = memchr(incoming, ',', len);
+    if (p) p = memchr(p + 1, ',', (size_t)(e - p - 1));    // rid,customer,iso,...
+    Field f = { p ? p + 1 : e, p ? (int)(e - p - 1 < 19 ? e - p - 1 : 19) : 0 };
+    int day = 0, tod;
+    iso_parse(f, &day, &tod);
+    long long size = file_size(RECEIPTS_FILE);
+    if (size > 0) {
+        if (!lg->activeDay) lg->activeDay = receipt_first_day(RECEIPTS_FILE);
+        if (size + (long long)len <= RECEIPT_SEG_MAX_BYTES && (!day || !lg->activeDay || day == lg->activeDay)) return;
+        if (!receipt_log_seal(size)) { printf("Warning: cannot seal %s\n", RECEIPTS_FILE); return; }
+    }
+    lg->activeDay = day;
+}
+
+/* Highest receipt id in the log: the tail of receipts.txt, else the last
+   sealed segment's. */
+int receipt_log_last_id() {
+    ReceiptLog *lg = receipt_log_get();
+    int last = tail_last_id(RECEIPTS_FILE);
+    if (lg->count && lg->zone[lg->count - 1].maxRid > last) last = lg->zone[lg->count - 1].maxRid;
+    return last;
+}
+
+/* Concatenates sealed segments [i, j) into the first one's file. The
+   merged file replaces it before the manifest changes, so a crash in
+   between is repaired by receipt_log_get() following the chain. */
+static int receipt_log_merge(int i, int j) {
+    ReceiptLog *lg = &g_receiptLog;
+    char path[64], tmp[72], src[64], buf[1 << 16];
+    receipt_seg_path(path, sizeof(path), lg->zone[i].base);
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *out = fopen(tmp, "wb");
+    if (!out) return 0;
+    ReceiptZone z = lg->zone[i];
+    int ok = 1;
+    for (int k = i; ok && k < j; ++k) {
+        receipt_seg_path(src, sizeof(src), lg->zone[k].base);
+        FILE *in = fopen(src, "rb");
+        long long copied = 0;
+        size_t n;
+        ok = in != NULL;
+        while (ok && (n = fread(buf, 1, sizeof(buf), in)) > 0) { ok = fwrite(buf, 1, n, out) == n; copied += (long long)n; }
+        if (in) fclose(in);
+        ok = ok && copied == lg->zone[k].bytes;
+        if (k > i) receipt_zone_fold(&z, &lg->zone[k]);
+    }
+    if (!sync_file(out)) ok = 0;
+    if (fclose(out) != 0) ok = 0;
+#ifdef _WIN32
+    if (ok) remove(path);
+#endif
+    if (!ok || rename(tmp, path) != 0) { remove(tmp); return 0; }
+    long long *gone = xrealloc(NULL, sizeof(long long) * (size_t)(j - i));
+    for (int k = i + 1; k < j; ++k) gone[k - i] = lg->zone[k].base;
+    lg->zone[i] = z;
+    memmove(&lg->zone[i + 1], &lg->zone[j], sizeof(ReceiptZone) * (size_t)(lg->count - j));
+    lg->count -= j - i - 1;
+    if (!receipt_log_save()) printf("Warning: cannot update %s\n", RECEIPT_SEG_MANIFEST);
+    for (int k = i + 1; k < j; ++k) { receipt_seg_path(src, sizeof(src), gone[k - i]); remove(src); }
+    free(gone);
+    return 1;
+}
+
+/* Merges each run of adjacent sealed segments that all fall within one
+   month before the current one into a single segment. Log offsets do not
+   change. Returns 0 if a merge failed. */
+int receipt_log_compact() {
+    group_commit_flush();
+    ReceiptLog *lg = receipt_log_get();
+    time_t t = time(NULL);
+    struct tm *lt = localtime(&t);
+    int thisMonth = (lt->tm_year + 1900) * 100 + lt->tm_mon + 1, before = lg->count;
+    for (int i = 0; i < lg->count; ++i) {
+        int month = lg->zone[i].minDay / 100, j = i;
+        while (j < lg->count && lg->zone[j].minDay / 100 == month && lg->zone[j].maxDay / 100 == month) j++;
+        if (month >= thisMonth || j - i < 2) continue;
+        if (!receipt_log_merge(i, j)) { printf("Cannot compact segments of %d.\n", month); return 0; }
+    }
+    printf("Compacted %d sealed receipt segments into %d.\n", before, lg->count);
+    return 1;
+}
+
+/* ---------- Columnar sales store ---------- */
+
+static SalesStore g_sales;
+static const char *const sales_col_file[SALES_COLS] = { "rid", "day", "tod", "code", "qty", "amount", "cust", "item" };
+static const size_t sales_col_size[SALES_COLS] = { 4, 4, 4, 4, 4, sizeof(Money), 4, 4 };
+static const char *const sales_dict_file[SALES_DICTS] = { "customers.dict", "items.dict" };
+
+static void sales_path(char *out, size_t n, const char *file) {
+    snprintf(out, n, "%s/%s", SALES_STORE_DIR, file);
+}
+
+static int sales_meta_write() {
+    char path[256], tmp[272];
+    sales_path(path, sizeof(path), "meta");
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *fp = fopen(tmp, "wb");
+    if (!fp) return 0;
+    int ok = fwrite(&g_sales.meta, sizeof(g_sales.meta), 1, fp) == 1 && sync_file(fp);
+    if (fclose(fp) != 0) ok = 0;
+    if (!ok) { remove(tmp); return 0; }
+#ifdef _WIN32
+    remove(path);
+#endif
+    return rename(tmp, path) == 0;
+}
+
+static void sales_unload() {
+    for (int c = 0; c < SALES_COLS; ++c) { free(g_sales.col[c]); g_sales.col[c] = NULL; g_sales.colCap[c] = 0; }
+    for (int d = 0; d < SALES_DICTS; ++d) dict_free(&g_sales.dict[d]);
+    g_sales.dictsLoaded = 0;
+}
+
+/* Empties the store; the next sync folds receipts.txt in from the start. */
+static int sales_store_reset() {
+    char path[256];
+    sales_unload();
+    if (!make_dir(SALES_STORE_DIR)) return 0;
+    for (int c = 0; c < SALES_COLS + SALES_DICTS; ++c) {
+        sales_path(path, sizeof(path), c < SALES_COLS ? sales_col_file[c] : sales_dict_file[c - SALES_COLS]);
+        FILE *fp = fopen(path, "wb");
+        if (!fp) return 0;
+        fclose(fp);
+    }
+    memset(&g_sales.meta, 0, sizeof(g_sales.meta));
+    memcpy(g_sales.meta.magic, SALES_MAGIC, sizeof(SALES_MAGIC));
+    g_sales.meta.version = SALES_VERSION;
+    return sales_meta_write();
+}
+
+/* Reads meta and checks every file is at least as long as it claims. */
+static int sales_store_open() {
+    char path[256];
+    sales_path(path, sizeof(path), "meta");
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return 0;
+    SalesMeta m;
+    int ok = fread(&m, sizeof(m), 1, fp) == 1 && memcmp(m.magic, SALES_MAGIC, sizeof(SALES_MAGIC)) == 0
+             && m.version == SALES_VERSION;
+    fclose(fp);
+    for (int c = 0; ok && c < SALES_COLS; ++c) {
+        sales_path(path, sizeof(path), sales_col_file[c]);
+        ok = file_size(path) >= (long long)m.rows * (long long)sales_col_size[c];
+    }
+    for (int d = 0; ok && d < SALES_DICTS; ++d) {
+        sales_path(path, sizeof(path), sales_dict_file[d]);
+        ok = file_size(path) >= m.dictBytes[d];
+    }
+    if (ok) g_sales.meta = m;
+    return ok;
+}
+
+static int sales_dicts_load() {
+    if (g_sales.dictsLoaded) return 1;
+    char path[256];
+    for (int d = 0; d < SALES_DICTS; ++d) {
+        CsvReader r;
+        sales_path(path, sizeof(path), sales_dict_file[d]);
+        if (!csv_open(&r, path)) return 0;
+        // one whole line per entry; names never contain newlines
+        while ((uint32_t)g_sales.dict[d].count < g_sales.meta.dictCount[d] && csv_next(&r, 1) > 0) {
+            char name[MAX_LINE];
+            field_copy(r.f[0], name, sizeof(name));
+            dict_intern(&g_sales.dict[d], name);
+        }
+        csv_close(&r);
+        if ((uint32_t)g_sales.dict[d].count != g_sales.meta.dictCount[d]) return 0;
+    }
+    g_sales.dictsLoaded = 1;
+    return 1;
+}
+
+/* Column values for all meta.rows receipt lines, read on first use. */
+const void* sales_column(int col) {
+    size_t need = (size_t)g_sales.meta.rows * sales_col_size[col];
+    if (!g_sales.col[col]) {
+        char path[256];
+        sales_path(path, sizeof(path), sales_col_file[col]);
+        g_sales.colCap[col] = g_sales.meta.rows ? g_sales.meta.rows : 1;
+        g_sales.col[col] = xrealloc(NULL, g_sales.colCap[col] * sales_col_size[col]);
+        FILE *fp = fopen(path, "rb");
+        size_t got = fp ? fread(g_sales.col[col], 1, need, fp) : 0;
+        if (fp) fclose(fp);
+        if (got < need) memset((char *)g_sales.col[col] + got, 0, need - got);
+    }
+    return g_sales.col[col];
+}
+
+static int sales_dict_append(FILE *fp, int d, const char *s) {
+    int before = g_sales.dict[d].count;
+    int id = dict_intern(&g_sales.dict[d], s);
+    if (id == before) {
+        fprintf(fp, "%s\n", s);
+        g_sales.meta.dictBytes[d] += (int64_t)strlen(s) + 1;
+        g_sales.meta.dictCount[d]++;
+    }
+    return id;
+}
+
+/* Appends a batch of rows to every column file, and to the columns that
+   are already resident. */
+static int sales_flush(FILE *cols[], unsigned char *batch[], int n) {
+    for (int c = 0; c < SALES_COLS; ++c) {
+        size_t sz = sales_col_size[c];
+        if (fwrite(batch[c], sz, n, cols[c]) != (size_t)n) return 0;
+        if (g_sales.col[c]) {
+            size_t need = (size_t)g_sales.meta.rows + n;
+            if (need > g_sales.colCap[c]) {
+                while (need > g_sales.colCap[c]) g_sales.colCap[c] *= 2;
+                g_sales.col[c] = xrealloc(g_sales.col[c], g_sales.colCap[c] * sz);
+            }
+            memcpy((char *)g_sales.col[c] + (size_t)g_sales.meta.rows * sz, batch[c], n * sz);
+        }
+    }
+    g_sales.meta.rows += n;
+    return 1;
+}
+
+/* One scan chunk of receipt lines in column layout. Customer and item ids
+   are local to the chunk's dictionaries until the merge maps them. */
+typedef struct {
+    unsigned char *col[SALES_COLS];
+    int rows, cap;
+    StrDict dict[SALES_DICTS];
+} SalesChunk;
+
+typedef struct {
+    SalesChunk *chunk;
+    FILE *out[SALES_COLS + SALES_DICTS];
+} SalesScan;
+
+static int sales_scan_chunk(CsvReader *r, long long end, int chunk, void *arg) {
+    SalesChunk *k = &((SalesScan *)arg)->chunk[chunk];
+    ReceiptLine x;
+    char name[MAX_LINE];
+    int day, tod;
+    while (csv_tell(r) < end && csv_next(r, CSV_MAX_FIELDS) > 0) {
+        if (!receipt_parse(r, &x) || !iso_parse(x.iso, &day, &tod)) continue;
+        if (k->rows == k->cap) {
+            k->cap = k->cap ? k->cap * 2 : SALES_BATCH;
+            for (int c = 0; c < SALES_COLS; ++c) k->col[c] = xrealloc(k->col[c], (size_t)k->cap * sales_col_size[c]);
+        }
+        int n = k->rows++;
+        ((int32_t *)k->col[SC_RID])[n] = x.rid;
+        ((int32_t *)k->col[SC_DAY])[n] = day;
+        ((int32_t *)k->col[SC_TOD])[n] = tod;
+        ((int32_t *)k->col[SC_CODE])[n] = x.code;
+        ((int32_t *)k->col[SC_QTY])[n] = x.qty;
+        ((Money *)k->col[SC_AMOUNT])[n] = x.subtotal;
+        field_copy(x.customer, name, sizeof(name));
+        ((int32_t *)k->col[SC_CUST])[n] = dict_intern(&k->dict[SD_CUSTOMER], name);
+        field_copy(x.name, name, sizeof(name));
+        ((int32_t *)k->col[SC_ITEM])[n] = dict_intern(&k->dict[SD_ITEM], name);
+    }
+    return 1;
+}
+
+/* Maps the chunk's dictionary ids to the store's, appending new strings in
+   the order they first appear (so ids match a single-threaded ingest), and
+   appends its rows. */
+static int sales_scan_merge(int chunk, int ok, void *arg) {
+    SalesScan *ss = arg;
+    SalesChunk *k = &ss->chunk[chunk];
+    for (int d = 0; d < SALES_DICTS; ++d) {
+        int *map = xrealloc(NULL, sizeof(int) * (k->dict[d].count ? k->dict[d].count : 1));
+        for (int i = 0; ok && i < k->dict[d].count; ++i)
+            map[i] = sales_dict_append(ss->out[SALES_COLS + d], d, dict_str(&k->dict[d], i));
+        int32_t *ids = (int32_t *)k->col[d == SD_CUSTOMER ? SC_CUST : SC_ITEM];
+        for (int n = 0; ok && n < k->rows; ++n) ids[n] = map[ids[n]];
+        free(map);
+        dict_free(&k->dict[d]);
+    }
+    if (ok && k->rows) ok = sales_flush(ss->out, k->col, k->rows);
+    for (int c = 0; c < SALES_COLS; ++c) free(k->col[c]);
+    return ok;
+}
+
+/* Folds receipt log lines past meta.srcBytes into the store with a
+   parallel scan. A torn final line is left for the next sync. */
+static int sales_ingest() {
+    long long size = receipt_log_size();
+    if (size < 0) return 1;
+    ParallelScan s;
+    if (!sales_dicts_load() || !receipt_log_split(&s, g_sales.meta.srcBytes, size, NULL, NULL)) return 0;
+    SalesScan ss;
+    memset(&ss, 0, sizeof(ss));
+    ss.chunk = xrealloc(NULL, sizeof(SalesChunk) * (size_t)s.chunks);
+    memset(ss.chunk, 0, sizeof(SalesChunk) * (size_t)s.chunks);
+    char path[256];
+    int ok = 1;
+    for (int c = 0; c < SALES_COLS + SALES_DICTS; ++c) {
+        int isCol = c < SALES_COLS;
+        sales_path(path, sizeof(path), isCol ? sales_col_file[c] : sales_dict_file[c - SALES_COLS]);
+        ss.out[c] = fopen(path, "r+b");
+        long long at = isCol ? (long long)g_sales.meta.rows * (long long)sales_col_size[c]
+                             : g_sales.meta.dictBytes[c - SALES_COLS];
+        if (!ss.out[c] || !file_seek(ss.out[c], at)) ok = 0;
+    }
+    if (ok) ok = scan_run(&s, sales_scan_chunk, sales_scan_merge, &ss);
+    long long consumed = s.stop;
+    for (int c = 0; c < SALES_COLS + SALES_DICTS; ++c)
+        if (ss.out[c]) { if (!sync_file(ss.out[c])) ok = 0; fclose(ss.out[c]); }
+    free(ss.chunk);
+    scan_free(&s);
+    if (!ok) { sales_unload(); return 0; }   // meta is untouched, so the store stays at its last good state
+    g_sales.meta.srcBytes = consumed;
+    return sales_meta_write();
+}
+
+/* Brings the store up to date with the receipt log and returns it, or
+   NULL when there are no receipts. A log shorter than what was folded in
+   means it was replaced, so the store is rebuilt. */
+SalesStore* sales_store_get() {
+    long long size = receipt_log_size();
+    if (size < 0) return NULL;
+    if (!g_sales.loaded) {
+        if (!sales_store_open() && !sales_store_reset()) { printf("Cannot create %s.\n", SALES_STORE_DIR); return NULL; }
+        g_sales.loaded = 1;
+    }
+    if (size < g_sales.meta.srcBytes && !sales_store_reset()) return NULL;
+    if (size > g_sales.meta.srcBytes && !sales_ingest()) {
+        printf("Warning: could not update %s; reports may be incomplete.\n", SALES_STORE_DIR);
+        sales_store_open();
+    }
+    return &g_sales;
+}
+
+int sales_store_rebuild() {
+    g_sales.loaded = 1;
+    if (!sales_store_reset()) return 0;
+    if (receipt_log_size() >= 0 && !sales_ingest()) return 0;
+    printf("Rebuilt %s from %s: %u rows.\n", SALES_STORE_DIR, RECEIPTS_FILE, g_sales.meta.rows);
+    return 1;
+}
+
+/* ---------- Sales rollups ---------- */
+
+static Rollups g_rollups;
+
+static uint64_t rollup_product_key(int code, int day) {
+    return ((uint64_t)(uint32_t)code << 32) | (uint32_t)day;
+}
+
+static unsigned rollup_hash(uint64_t key) {
+    return (unsigned)((key * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
+/* Returns the entry for key, or NULL if absent and create is 0. */
+static RollupEntry* rollup_find(RollupTable *t, uint64_t key, int create) {
+    if (create && (t->count + 1) * 2 > t->cap) {
+        RollupEntry *old = t->e;
+        int oldCap = t->cap;
+        t->cap = t->cap ? t->cap * 2 : 64;
+        t->e = xrealloc(NULL, sizeof(RollupEntry) * t->cap);
+        memset(t->e, 0, sizeof(RollupEntry) * t->cap);
+        for (int i = 0; i < oldCap; ++i) {
+            if (!old[i].key) continue;
+            unsigned h = rollup_hash(old[i].key) & (unsigned)(t->cap - 1);
+            while (t->e[h].key) h = (h + 1) & (unsigned)(t->cap - 1);
+            t->e[h] = old[i];
+        }
+        free(old);
+    }
+    if (t->cap == 0) return NULL;
+    unsigned mask = (unsigned)t->cap - 1;
+    unsigned h = rollup_hash(key) & mask;
+    while (t->e[h].key) {
+        if (t->e[h].key == key) return &t->e[h];
+        h = (h + 1) & mask;
+    }
+    if (!create) return NULL;
+    t->e[h].key = key;
+    t->count++;
+    return &t->e[h];
+}
+
+static void rollup_add_to(RollupTable t[], int day, int code, int qty, Money amount) {
+    uint64_t keys[ROLLUP_TABLES] = { (uint64_t)day, (uint64_t)(day / 100), rollup_product_key(code, day) };
+    for (int k = 0; k < ROLLUP_TABLES; ++k) {
+        RollupEntry *e = rollup_find(&t[k], keys[k], 1);
+        e->qty += qty;
+        e->revenue += amount;
+    }
+}
+
+static void rollup_add(int day, int code, int qty, Money amount) {
+    rollup_add_to(g_rollups.t, day, code, qty, amount);
+}
+
+static void rollups_clear() {
+    for (int k = 0; k < ROLLUP_TABLES; ++k) free(g_rollups.t[k].e);
+    memset(g_rollups.t, 0, sizeof(g_rollups.t));
+    g_rollups.srcBytes = 0;
+}
+
+static int rollups_load_snapshot() {
+    FILE *fp = fopen(ROLLUP_FILE, "rb");
+    if (!fp) return 0;
+    RollupFileHeader h;
+    int ok = fread(&h, sizeof(h), 1, fp) == 1 && memcmp(h.magic, ROLLUP_MAGIC, sizeof(ROLLUP_MAGIC)) == 0
+             && h.version == ROLLUP_VERSION;
+    RollupEntry e;
+    for (int k = 0; ok && k < ROLLUP_TABLES; ++k) {
+        for (uint32_t i = 0; ok && i < h.count[k]; ++i) {
+            ok = fread(&e, sizeof(e), 1, fp) == 1 && e.key != 0;
+            if (ok) *rollup_find(&g_rollups.t[k], e.key, 1) = e;
+        }
+    }
+    fclose(fp);
+    if (ok) g_rollups.srcBytes = h.srcBytes;
+    else rollups_clear();
+    return ok;
+}
+
+static int rollups_save() {
+    const char *tmp = ROLLUP_FILE ".tmp";
+    FILE *fp = fopen(tmp, "wb");
+    if (!fp) return 0;
+    RollupFileHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, ROLLUP_MAGIC, sizeof(ROLLUP_MAGIC));
+    h.version = ROLLUP_VERSION;
+    h.srcBytes = g_rollups.srcBytes;
+    for (int k = 0; k < ROLLUP_TABLES; ++k) h.count[k] = (uint32_t)g_rollups.t[k].count;
+    int ok = fwrite(&h, sizeof(h), 1, fp) == 1;
+    for (int k = 0; ok && k < ROLLUP_TABLES; ++k) {
+        const RollupTable *t = &g_rollups.t[k];
+        for (int i = 0; ok && i < t->cap; ++i)
+            if (t->e[i].key) ok = fwrite(&t->e[i], sizeof(RollupEntry), 1, fp) == 1;
+    }
+    if (!sync_file(fp)) ok = 0;
+    if (fclose(fp) != 0) ok = 0;
+    if (!ok) { remove(tmp); return 0; }
+#ifdef _WIN32
+    remove(ROLLUP_FILE);
+#endif
+    if (rename(tmp, ROLLUP_FILE) != 0) return 0;
+    remove(ROLLUP_LOG_FILE);
+    return 1;
+}
+
+/* rollups.log holds "d,day,code,qty,amount" lines, each checkout closed by
+   "c,receiptsBytes". Deltas without their commit line are dropped.
+   Returns the number of checkouts applied. */
+static int rollups_replay_log() {
+    CsvReader r;
+    if (!csv_open(&r, ROLLUP_LOG_FILE)) return 0;
+    typedef struct { int day, code, qty; Money amount; } Delta;
+    Delta *pending = NULL;
+    int n = 0, cap = 0, commits = 0;
+    while (csv_next(&r, 5) > 0 && !r.torn) {
+        if (r.f[0].len != 1) continue;
+        if (r.f[0].p[0] == 'd' && r.nf == 5) {
+            Delta d;
+            if (!field_int(r.f[1], &d.day) || !field_int(r.f[2], &d.code) || !field_int(r.f[3], &d.qty)
+                || !field_cents(r.f[4], &d.amount)) continue;
+            if (n == cap) { cap = cap ? cap * 2 : 64; pending = xrealloc(pending, sizeof(Delta) * cap); }
+            pending[n++] = d;
+        } else if (r.f[0].p[0] == 'c' && r.nf == 2) {
+            long long bytes;
+            if (!field_int64(r.f[1], &bytes)) continue;
+            for (int i = 0; i < n; ++i) rollup_add(pending[i].day, pending[i].code, pending[i].qty, pending[i].amount);
+            g_rollups.srcBytes = bytes;
+            n = 0;
+            commits++;
+        }
+    }
+    csv_close(&r);
+    free(pending);
+    return commits;
+}
+
+/* Scan kernel: one chunk of the receipt log into its own ROLLUP_TABLES tables
+   of the array at arg. */
+static int rollups_scan_chunk(CsvReader *r, long long end, int chunk, void *arg) {
+    RollupTable *t = (RollupTable *)arg + (size_t)chunk * ROLLUP_TABLES;
+    ReceiptLine x;
+    int day, tod;
+    while (csv_tell(r) < end && csv_next(r, CSV_MAX_FIELDS) > 0)
+        if (receipt_parse(r, &x) && iso_parse(x.iso, &day, &tod)) rollup_add_to(t, day, x.code, x.qty, x.subtotal);
+    return 1;
+}
+
+static int rollups_scan_merge(int chunk, int ok, void *arg) {
+    RollupTable *t = (RollupTable *)arg + (size_t)chunk * ROLLUP_TABLES;
+    for (int k = 0; k < ROLLUP_TABLES; ++k) {
+        for (int i = 0; ok && i < t[k].cap; ++i) {
+            if (!t[k].e[i].key) continue;
+            RollupEntry *e = rollup_find(&g_rollups.t[k], t[k].e[i].key, 1);
+            e->qty += t[k].e[i].qty;
+            e->revenue += t[k].e[i].revenue;
+        }
+        free(t[k].e);
+    }
+    return 1;
+}
+
+/* Regenerates every rollup from the receipt log with a parallel scan. */
+int rollups_rebuild() {
+    rollups_clear();
+    g_rollups.loaded = 1;
+    long long size = receipt_log_size();
+    ParallelScan s;
+    if (size > 0) {
+        if (!receipt_log_split(&s, 0, size, NULL, NULL)) return 0;
+        RollupTable *parts = xrealloc(NULL, sizeof(RollupTable) * ROLLUP_TABLES * (size_t)s.chunks);
+        memset(parts, 0, sizeof(RollupTable) * ROLLUP_TABLES * (size_t)s.chunks);
+        int ok = scan_run(&s, rollups_scan_chunk, rollups_scan_merge, parts);
+        g_rollups.srcBytes = s.stop;
+        free(parts);
+        scan_free(&s);
+        if (!ok) { rollups_clear(); return 0; }
+    }
+    return rollups_save();
+}
+
+/* Loads the snapshot, folds in the log, and rebuilds when the receipt log
+   no longer matches what the rollups were built from. srcBytes already
+   counts queued checkouts, so the caller holds g_commitLock with nothing
+   queued but the records of the checkout being recorded, if any. */
+static void rollups_sync() {
+    if (!g_rollups.loaded) {
+        g_rollups.loaded = 1;
+        rollups_load_snapshot();
+        if (rollups_replay_log() > 0) rollups_save();
+    }
+    long long size = receipt_log_size();
+    if ((size < 0 ? 0 : size) != g_rollups.srcBytes) rollups_rebuild();
+}
+
+Rollups* rollups_get() {
+    mutex_lock(&g_commitLock);
+    group_drain_locked();
+    rollups_sync();
+    mutex_unlock(&g_commitLock);
+    return &g_rollups;
+}
+
+/* Folds a checkout into the rollups and queues its log lines in the same
+   group commit as its receipt lines, which are written first. The receipt
+   log must not have grown since the rollups were loaded except through here. */
+void rollups_record_checkout(CartItem cart[], int cartCount, int day, long long receiptBytes) {
+    if (receiptBytes <= 0) return;
+    if (!g_rollups.loaded) rollups_sync();
+    TextBuf *b = &g_group.pending[GC_ROLLUP_LOG];
+    char amt[CENTS_CHARS];
+    for (int i = 0; i < cartCount; ++i) {
+        rollup_add(day, cart[i].code, cart[i].qty, cart[i].total);
+        tb_printf(b, "d,%d,%d,%d,%s\n", day, cart[i].code, cart[i].qty, cents_str(amt, cart[i].total));
+    }
+    g_rollups.srcBytes += receiptBytes;
+    tb_printf(b, "c,%lld\n", g_rollups.srcBytes);
+}
+
+static int int_cmp(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+/* Day keys present in the day rollup within [lo, hi], ascending. */
+static int rollup_days(int lo, int hi, int **out) {
+    const RollupTable *t = &g_rollups.t[RU_DAY];
+    int *days = xrealloc(NULL, sizeof(int) * (t->count ? t->count : 1)), n = 0;
+    for (int i = 0; i < t->cap; ++i)
+        if (t->e[i].key && (int)t->e[i].key >= lo && (int)t->e[i].key <= hi) days[n++] = (int)t->e[i].key;
+    qsort(days, n, sizeof(int), int_cmp);
+    *out = days;
+    return n;
+}
+
+/* ---------- Receipt index ---------- */
+
+static ReceiptIndex g_receiptIndex;
+
+/* Case-insensitive FNV-1a of a customer name. Receipts only carry the
+   name, so this is the customer's identity in the index; hits are
+   confirmed against the receipt lines when they are read. */
+static uint64_t customer_key(const char *p, size_t n) {
+    uint64_t h = 1469598103934665603ull;
+    for (size_t i = 0; i < n; ++i) { h ^= (uint64_t)tolower((unsigned char)p[i]); h *= 1099511628211ull; }
+    return h;
+}
+
+/* Head table slot of key: its newest entry, or the empty slot for it. */
+static int receipt_index_slot(uint64_t key) {
+    const ReceiptIndex *x = &g_receiptIndex;
+    int i = (int)(key & (uint64_t)(x->headCap - 1));
+    while (x->head[i] >= 0 && x->e[x->head[i]].cust != key) i = (i + 1) & (x->headCap - 1);
+    return i;
+}
+
+static void receipt_index_push(const ReceiptIndexEntry *en) {
+    ReceiptIndex *x = &g_receiptIndex;
+    if (x->count == x->cap) {
+        x->cap = x->cap ? x->cap * 2 : 1024;
+        x->e = xrealloc(x->e, sizeof(ReceiptIndexEntry) * x->cap);
+        x->prev = xrealloc(x->prev, sizeof(int32_t) * x->cap);
+    }
+    if ((x->customers + 1) * 2 > x->headCap) {
+        int32_t *old = x->head;
+        int oldCap = x->headCap;
+        x->headCap = oldCap ? oldCap * 2 : 1024;
+        x->head = xrealloc(NULL, sizeof(int32_t) * x->headCap);
+        for (int i = 0; i < x->headCap; ++i) x->head[i] = -1;
+        for (int i = 0; i < oldCap; ++i) if (old[i] >= 0) x->head[receipt_index_slot(x->e[old[i]].cust)] = old[i];
+        free(old);
+    }
+    int n = x->count++, s = receipt_index_slot(en->cust);
+    x->e[n] = *en;
+    if (x->head[s] < 0) x->customers++;
+    x->prev[n] = x->head[s];
+    x->head[s] = n;
+    if (en->offset + (int64_t)en->bytes > x->srcBytes) x->srcBytes = en->offset + (int64_t)en->bytes;
+}
+
+static void receipt_index_clear() {
+    ReceiptIndex *x = &g_receiptIndex;
+    free(x->e); free(x->prev); free(x->head);
+    int loaded = x->loaded;
+    memset(x, 0, sizeof(*x));
+    x->loaded = loaded;
+}
+
+static int receipt_index_write_header(FILE *fp, int64_t srcBytes) {
+    ReceiptIndexHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, RECEIPT_INDEX_MAGIC, sizeof(RECEIPT_INDEX_MAGIC));
+    h.version = RECEIPT_INDEX_VERSION;
+    h.recordSize = sizeof(ReceiptIndexEntry);
+    h.srcBytes = srcBytes;
+    return file_seek(fp, 0) && fwrite(&h, sizeof(h), 1, fp) == 1;
+}
+
+/* Reads receipts.idx. A torn last entry, or one past the end of
+   receiptsSize (its receipt lines never made it to disk), makes the file
+   unusable, since later entries would be appended after it. */
+static int receipt_index_load(long long receiptsSize) {
+    long long size = file_size(RECEIPT_INDEX_FILE);
+    FILE *fp = fopen(RECEIPT_INDEX_FILE, "rb");
+    if (!fp) return 0;
+    ReceiptIndexHeader h;
+    int ok = fread(&h, sizeof(h), 1, fp) == 1 && memcmp(h.magic, RECEIPT_INDEX_MAGIC, sizeof(RECEIPT_INDEX_MAGIC)) == 0
+             && h.version == RECEIPT_INDEX_VERSION && h.recordSize == sizeof(ReceiptIndexEntry)
+             && h.srcBytes <= receiptsSize && (size - (long long)sizeof(h)) % (long long)sizeof(ReceiptIndexEntry) == 0;
+    ReceiptIndexEntry buf[1024];
+    size_t got;
+    while (ok && (got = fread(buf, sizeof(ReceiptIndexEntry), 1024, fp)) > 0) {
+        for (size_t i = 0; ok && i < got; ++i) {
+            ok = buf[i].offset >= 0 && buf[i].offset + (int64_t)buf[i].bytes <= receiptsSize;
+            if (ok) receipt_index_push(&buf[i]);
+        }
+    }
+    fclose(fp);
+    if (ok && h.srcBytes > g_receiptIndex.srcBytes) g_receiptIndex.srcBytes = h.srcBytes;
+    else if (!ok) receipt_index_clear();
+    return ok;
+}
+
+static int receipt_index_reset() {
+    receipt_index_clear();
+    FILE *fp = fopen(RECEIPT_INDEX_FILE, "wb");
+    if (!fp) return 0;
+    int ok = receipt_index_write_header(fp, 0) && sync_file(fp);
+    if (fclose(fp) != 0) ok = 0;
+    return ok;
+}
+
+/* Entries for one scan chunk. A receipt split across chunks shows up as
+   the last entry of one and the first of the next; the merge joins them. */
+typedef struct {
+    ReceiptIndexEntry *e;
+    int n, cap;
+} ReceiptIndexChunk;
+
+typedef struct {
+    ReceiptIndexChunk *chunk;
+    FILE *fp;
+    ReceiptIndexEntry cur;  // last entry seen, not yet written
+    int open;
+} ReceiptIndexScan;
+
+/* Extends cur with a run of lines that continues it, or returns 0. */
+static int receipt_index_join(ReceiptIndexEntry *cur, const ReceiptIndexEntry *next) {
+    if (cur->rid != next->rid || cur->cust != next->cust || cur->offset + (int64_t)cur->bytes != next->offset) return 0;
+    cur->bytes += next->bytes;
+    cur->lines += next->lines;
+    return 1;
+}
+
+static int receipt_index_scan_chunk(CsvReader *r, long long end, int chunk, void *arg) {
+    ReceiptIndexChunk *k = &((ReceiptIndexScan *)arg)->chunk[chunk];
+    ReceiptLine rl;
+    while (csv_tell(r) < end) {
+        long long start = csv_tell(r);
+        if (csv_next(r, CSV_MAX_FIELDS) == 0) break;
+        int day, tod;
+        if (!receipt_parse(r, &rl) || !iso_parse(rl.iso, &day, &tod)) continue;
+        ReceiptIndexEntry e = { customer_key(rl.customer.p, (size_t)rl.customer.len), start, rl.rid, day,
+                                (uint32_t)(csv_tell(r) - start), 1 };
+        if (k->n && receipt_index_join(&k->e[k->n - 1], &e)) continue;
+        if (k->n == k->cap) { k->cap = k->cap ? k->cap * 2 : 1024; k->e = xrealloc(k->e, sizeof(ReceiptIndexEntry) * k->cap); }
+        k->e[k->n++] = e;
+    }
+    return 1;
+}
+
+static int receipt_index_scan_merge(int chunk, int ok, void *arg) {
+    ReceiptIndexScan *rs = arg;
+    ReceiptIndexChunk *k = &rs->chunk[chunk];
+    for (int i = 0; ok && i < k->n; ++i) {
+        if (rs->open && receipt_index_join(&rs->cur, &k->e[i])) continue;
+        if (rs->open) { receipt_index_push(&rs->cur); ok = fwrite(&rs->cur, sizeof(rs->cur), 1, rs->fp) == 1; }
+        rs->cur = k->e[i];
+        rs->open = 1;
+    }
+    free(k->e);
+    return ok;
+}
+
+/* Indexes the receipt log lines past srcBytes with a parallel scan, one
+   entry per run of lines with the same receipt id and customer, and
+   appends the entries. A torn final line is left for next time. */
+static int receipt_index_ingest() {
+    ReceiptIndex *x = &g_receiptIndex;
+    long long size = receipt_log_size();
+    if (size < 0) return 1;
+    ParallelScan s;
+    if (!receipt_log_split(&s, x->srcBytes, size, NULL, NULL)) return 0;
+    ReceiptIndexScan rs;
+    memset(&rs, 0, sizeof(rs));
+    rs.chunk = xrealloc(NULL, sizeof(ReceiptIndexChunk) * (size_t)s.chunks);
+    memset(rs.chunk, 0, sizeof(ReceiptIndexChunk) * (size_t)s.chunks);
+    rs.fp = fopen(RECEIPT_INDEX_FILE, "r+b");
+    int ok = rs.fp && file_seek(rs.fp, (long long)sizeof(ReceiptIndexHeader) + (long long)x->count * (long long)sizeof(ReceiptIndexEntry));
+    if (ok) ok = scan_run(&s, receipt_index_scan_chunk, receipt_index_scan_merge, &rs);
+    if (ok && rs.open) { receipt_index_push(&rs.cur); ok = fwrite(&rs.cur, sizeof(rs.cur), 1, rs.fp) == 1; }
+    long long consumed = s.stop;
+    free(rs.chunk);
+    scan_free(&s);
+    if (ok) ok = receipt_index_write_header(rs.fp, consumed) && sync_file(rs.fp);
+    if (rs.fp && fclose(rs.fp) != 0) ok = 0;
+    if (ok) x->srcBytes = consumed;
+    return ok;
+}
+
+/* Loads the index and folds in receipt log lines it has not seen,
+   rebuilding it when the file is missing or damaged or the log has
+   shrunk. Checkouts keep it current from then on. */
+ReceiptIndex* receipt_index_get() {
+    ReceiptIndex *x = &g_receiptIndex;
+    if (x->loaded) return x;
+    x->loaded = 1;
+    long long size = receipt_log_size();
+    if (size < 0) size = 0;
+    if (!receipt_index_load(size) && !receipt_index_reset()) printf("Cannot create %s.\n", RECEIPT_INDEX_FILE);
+    if (x->srcBytes < size && !receipt_index_ingest()) {
+        printf("Warning: could not update %s; run --rebuild-receipt-index.\n", RECEIPT_INDEX_FILE);
+        x->srcBytes = size;     // new checkouts must still get the right offsets
+    }
+    return x;
+}
+
+int receipt_index_rebuild() {
+    g_receiptIndex.loaded = 1;
+    if (!receipt_index_reset() || !receipt_index_ingest()) return 0;
+    printf("Rebuilt %s from %s: %d receipts, %d customers.\n", RECEIPT_INDEX_FILE, RECEIPTS_FILE,
+           g_receiptIndex.count, g_receiptIndex.customers);
+    return 1;
+}
+
+/* Indexes a checkout whose receipt lines were just queued, and queues its
+   entry to be written after them in the same group commit. */
+void receipt_index_add(int rid, const char *customerName, const char *iso, size_t bytes, int lines) {
+    ReceiptIndex *x = receipt_index_get();
+    Field f = { iso, (int)strlen(iso) };
+    int day, tod;
+    if (!iso_parse(f, &day, &tod)) day = 0;
+    ReceiptIndexEntry en = { customer_key(customerName, strlen(customerName)), x->srcBytes, rid, day,
+                             (uint32_t)bytes, (uint32_t)lines };
+    receipt_index_push(&en);
+    tb_write(&g_group.pending[GC_RECEIPT_INDEX], &en, sizeof(en));
+}
+
 /* ---------- Reports ---------- */
 
 void report_menu() {
+    group_commit_flush();  // reports read the receipt log
     while (1) {
         printf("\n==== REPORT MENU ====\n");
         printf("1. Total income (all-time)\n");
@@ -584,6 +4668,8 @@ void report_menu() {
         printf("3. Monthly income\n");
         printf("4. Product-wise sales\n");
         printf("5. Top-selling products\n");
+        printf("6. Rebuild report rollups\n");
+        printf("7. Receipts containing a product\n");
         printf("0. Back\n");
         printf("Enter choice: ");
         int ch; if (scanf("%d", &ch) != 1) { while(getchar()!='\n'); ch=-1; }
@@ -595,65 +4681,96 @@ void report_menu() {
             case 3: report_monthly_income(); break;
             case 4: report_product_wise(); break;
             case 5: report_top_selling(); break;
+            case 6: printf(rollups_rebuild() ? "Rollups rebuilt from %s.\n" : "Failed to rebuild rollups from %s.\n", RECEIPTS_FILE); break;
+            case 7: report_product_receipts(); break;
             default: printf("Invalid.\n");
         }
         pause_console();
     }
 }
 
-void report_total_income() {
-    FILE *fp = fopen(RECEIPTS_FILE, "r");
-    if (!fp) { printf("No receipts found.\n"); return; }
-    double sum = 0.0; char line[MAX_LINE];
-    while (fgets(line, sizeof(line), fp)) {
-        trimnewline(line);
-        if (strlen(line)==0) continue;
-        int rid, code, qty; char cust[128], iso[64], name[128]; double unit, subtotal;
-        if (sscanf(line, "%d,%127[^,],%63[^,],%d,%127[^,],%d,%lf,%lf",
-                   &rid, cust, iso, &code, name, &qty, &unit, &subtotal) == 8) {
-            sum += subtotal;
-        }
+/* Empty slots hold zero revenue, so the whole table is summed. */
+Money income_total() {
+    const RollupTable *t = &rollups_get()->t[RU_MONTH];
+    Money sum = 0;
+    for (int i = 0; i < t->cap; ++i) sum += t->e[i].revenue;
+    return sum;
+}
+
+/* Income over day keys [lo, hi]. */
+Money income_days(int lo, int hi) {
+    Rollups *ru = rollups_get();
+    if (lo == hi) {
+        const RollupEntry *e = rollup_find(&ru->t[RU_DAY], (uint64_t)lo, 0);
+        return e ? e->revenue : 0;
     }
-    fclose(fp);
-    printf("Total income (all time): %.2f\n", sum);
+    Money sum = 0;
+    int *days, n = rollup_days(lo, hi, &days);
+    for (int i = 0; i < n; ++i) sum += rollup_find(&ru->t[RU_DAY], (uint64_t)days[i], 0)->revenue;
+    free(days);
+    return sum;
+}
+
+Money income_month(int yyyymm) {
+    const RollupEntry *e = rollup_find(&rollups_get()->t[RU_MONTH], (uint64_t)yyyymm, 0);
+    return e ? e->revenue : 0;
+}
+
+/* Revenue of the sales store's lines with day keys in [lo, hi], summed
+   straight off the day and amount columns. The range test becomes a mask
+   so the loop has no branches. */
+Money sales_revenue(int lo, int hi) {
+    SalesStore *ss = sales_store_get();
+    if (!ss) return 0;
+    const int32_t *day = sales_column(SC_DAY);
+    const Money *amount = sales_column(SC_AMOUNT);
+    Money sum = 0;
+    for (uint32_t i = 0; i < ss->meta.rows; ++i)
+        sum += amount[i] & -(Money)((day[i] >= lo) & (day[i] <= hi));
+    return sum;
+}
+
+/* Per-day sales of one product within day keys [lo, hi], oldest first, as
+   entries keyed by day. */
+int product_sales_by_day(int code, int lo, int hi, RollupEntry **out) {
+    Rollups *ru = rollups_get();
+    int *days, n = rollup_days(lo, hi, &days), m = 0;
+    RollupEntry *rows = xrealloc(NULL, sizeof(RollupEntry) * (n ? n : 1));
+    for (int i = 0; i < n; ++i) {
+        const RollupEntry *e = rollup_find(&ru->t[RU_PRODUCT_DAY], rollup_product_key(code, days[i]), 0);
+        if (!e) continue;
+        rows[m] = *e;
+        rows[m++].key = (uint64_t)days[i];
+    }
+    free(days);
+    *out = rows;
+    return m;
+}
+
+void report_total_income() {
+    if (receipt_log_size() < 0) { printf("No receipts found.\n"); return; }
+    char amt[CENTS_CHARS];
+    printf("Total income (all time): %s\n", cents_str(amt, income_total()));
 }
 
 void report_daily_income() {
-    char date[16];
+    char date[16], amt[CENTS_CHARS];
+    int lo, hi;
     printf("Enter date (YYYY-MM-DD): ");
     fgets(date, sizeof(date), stdin); trimnewline(date);
-    if (strlen(date)==0) { printf("Invalid.\n"); return; }
-    FILE *fp = fopen(RECEIPTS_FILE, "r");
-    if (!fp) { printf("No receipts.\n"); return; }
-    double sum = 0.0; char line[MAX_LINE];
-    while (fgets(line, sizeof(line), fp)) {
-        int rid, code, qty; char cust[128], iso[64], name[128]; double unit, subtotal;
-        if (sscanf(line, "%d,%127[^,],%63[^,],%d,%127[^,],%d,%lf,%lf",
-                   &rid, cust, iso, &code, name, &qty, &unit, &subtotal) == 8) {
-            if (strncmp(iso, date, strlen(date)) == 0) sum += subtotal;
-        }
-    }
-    fclose(fp);
-    printf("Total income on %s : %.2f\n", date, sum);
+    if (!date_range(date, &lo, &hi)) { printf("Invalid.\n"); return; }
+    if (receipt_log_size() < 0) { printf("No receipts.\n"); return; }
+    printf("Total income on %s : %s\n", date, cents_str(amt, income_days(lo, hi)));
 }
 
 void report_monthly_income() {
-    char yearmon[8];
+    char yearmon[8], amt[CENTS_CHARS];
+    int lo, hi;
     printf("Enter month (YYYY-MM): ");
     fgets(yearmon, sizeof(yearmon), stdin); trimnewline(yearmon);
-    if (strlen(yearmon) < 7) { printf("Invalid.\n"); return; }
-    FILE *fp = fopen(RECEIPTS_FILE, "r");
-    if (!fp) { printf("No receipts.\n"); return; }
-    double sum = 0.0; char line[MAX_LINE];
-    while (fgets(line, sizeof(line), fp)) {
-        int rid, code, qty; char cust[128], iso[64], name[128]; double unit, subtotal;
-        if (sscanf(line, "%d,%127[^,],%63[^,],%d,%127[^,],%d,%lf,%lf",
-                   &rid, cust, iso, &code, name, &qty, &unit, &subtotal) == 8) {
-            if (strncmp(iso, yearmon, 7) == 0) sum += subtotal;
-        }
-    }
-    fclose(fp);
-    printf("Total income in %s: %.2f\n", yearmon, sum);
+    if (strlen(yearmon) < 7 || !date_range(yearmon, &lo, &hi)) { printf("Invalid.\n"); return; }
+    if (receipt_log_size() < 0) { printf("No receipts.\n"); return; }
+    printf("Total income in %s: %s\n", yearmon, cents_str(amt, income_month(lo / 100)));
 }
 
 void report_product_wise() {
@@ -661,64 +4778,318 @@ void report_product_wise() {
     printf("Enter product code: ");
     if (scanf("%d", &pid) != 1) { while(getchar()!='\n'); printf("Invalid.\n"); return; }
     while(getchar()!='\n');
-    FILE *fp = fopen(RECEIPTS_FILE, "r");
-    if (!fp) { printf("No receipts.\n"); return; }
-    char line[MAX_LINE];
-    double total = 0.0; int qtySum = 0;
-    while (fgets(line, sizeof(line), fp)) {
-        int rid, code, qty; char cust[128], iso[64], name[128]; double unit, subtotal;
-        if (sscanf(line, "%d,%127[^,],%63[^,],%d,%127[^,],%d,%lf,%lf",
-                   &rid, cust, iso, &code, name, &qty, &unit, &subtotal) == 8) {
-            if (code == pid) { total += subtotal; qtySum += qty; printf("%s | %s | qty %d | subtotal %.2f\n", iso, name, qty, subtotal); }
-        }
+    if (receipt_log_size() < 0) { printf("No receipts.\n"); return; }
+    int pidx = catalog_find(pid);
+    const char *name = pidx >= 0 ? catalog_name(catalog_get(), pidx) : "-";
+    Money total = 0; long long qtySum = 0;
+    char amt[CENTS_CHARS];
+    RollupEntry *rows;
+    int n = product_sales_by_day(pid, 0, INT_MAX, &rows);
+    for (int i = 0; i < n; ++i) {
+        int day = (int)rows[i].key;
+        total += rows[i].revenue; qtySum += rows[i].qty;
+        printf("%04d-%02d-%02d | %s | qty %lld | subtotal %s\n",
+               day / 10000, day / 100 % 100, day % 100, name, (long long)rows[i].qty, cents_str(amt, rows[i].revenue));
     }
-    fclose(fp);
-    printf("Total sold qty: %d | Total revenue: %.2f\n", qtySum, total);
+    free(rows);
+    printf("Total sold qty: %lld | Total revenue: %s\n", qtySum, cents_str(amt, total));
 }
 
-int compare_top(const void *a, const void *b) {
-    const long *A = a;
-    const long *B = b;
-    if (A[2] != B[2]) return (B[2] - A[2]) > 0 ? 1 : -1;
-    if (A[3] > B[3]) return -1;
-    if (A[3] < B[3]) return 1;
-    return 0;
+typedef struct {
+    int code, category;
+    long long qty;
+    Money revenue;
+} TopSeller;
+
+/* Ranking order: more units first, then more revenue, then lower code. */
+static int top_seller_better(const TopSeller *a, const TopSeller *b) {
+    if (a->qty != b->qty) return a->qty > b->qty;
+    if (a->revenue != b->revenue) return a->revenue > b->revenue;
+    return a->code < b->code;
 }
 
-void report_top_selling() {
-    FILE *fp = fopen(SALES_ITEMS_FILE, "r");
-    if (!fp) { printf("No sales items.\n"); return; }
-    typedef struct { int code; char name[128]; long qty; double revenue; } Agg;
-    Agg agg[1000]; int aggc = 0;
-    char line[MAX_LINE];
-    while (fgets(line, sizeof(line), fp)) {
-        trimnewline(line);
-        if (strlen(line)==0) continue;
-        int code, qty; char name[128], date[64]; double price, subtotal;
-        if (sscanf(line, "%d,%127[^,],%d,%lf,%lf,%63[^\n]", &code, name, &qty, &price, &subtotal, date) == 6) {
-            int idx = -1;
-            for (int i=0;i<aggc;++i) if (agg[i].code == code) { idx = i; break; }
-            if (idx == -1) {
-                agg[aggc].code = code; strncpy(agg[aggc].name, name, sizeof(agg[aggc].name)); agg[aggc].qty = qty; agg[aggc].revenue = subtotal; aggc++;
-            } else {
-                agg[idx].qty += qty; agg[idx].revenue += subtotal;
+static int top_seller_cmp(const void *a, const void *b) {
+    return top_seller_better(a, b) ? -1 : top_seller_better(b, a) ? 1 : 0;
+}
+
+/* Sums the product-day rollup over day keys in [lo, hi] into one entry per
+   product. Returns the number of products that sold. */
+static int top_sellers_aggregate(int lo, int hi, TopSeller **out) {
+    const RollupTable *pd = &rollups_get()->t[RU_PRODUCT_DAY];
+    RollupTable agg;
+    memset(&agg, 0, sizeof(agg));
+    for (int i = 0; i < pd->cap; ++i) {
+        int day = (int)(uint32_t)pd->e[i].key;
+        if (!pd->e[i].key || day < lo || day > hi) continue;
+        RollupEntry *e = rollup_find(&agg, (pd->e[i].key >> 32) | (1ull << 32), 1);
+        e->qty += pd->e[i].qty;
+        e->revenue += pd->e[i].revenue;
+    }
+    Catalog *c = catalog_get();
+    TopSeller *all = xrealloc(NULL, sizeof(TopSeller) * (agg.count ? agg.count : 1));
+    int n = 0;
+    for (int i = 0; i < agg.cap; ++i) {
+        if (!agg.e[i].key) continue;
+        TopSeller *t = &all[n++];
+        t->code = (int)(uint32_t)agg.e[i].key;
+        int idx = catalog_find(t->code);
+        t->category = idx >= 0 ? c->categoryId[idx] : -1;
+        t->qty = agg.e[i].qty;
+        t->revenue = agg.e[i].revenue;
+    }
+    free(agg.e);
+    *out = all;
+    return n;
+}
+
+/* Best k sellers in category (-1 for any) via a bounded min-heap whose root
+   is the weakest kept entry; out is sorted best first. */
+static int top_sellers_select(const TopSeller *all, int n, int category, int k, TopSeller *out) {
+    int h = 0;
+    for (int i = 0; i < n; ++i) {
+        if (category >= 0 && all[i].category != category) continue;
+        int at;
+        if (h < k) {
+            at = h++;
+            while (at > 0 && top_seller_better(&out[(at-1)/2], &all[i])) { out[at] = out[(at-1)/2]; at = (at-1)/2; }
+            out[at] = all[i];
+        } else if (top_seller_better(&all[i], &out[0])) {
+            at = 0;
+            for (;;) {
+                int l = 2*at + 1, r = l + 1, m = at;
+                const TopSeller *mv = &all[i];
+                if (l < h && top_seller_better(mv, &out[l])) { m = l; mv = &out[l]; }
+                if (r < h && top_seller_better(mv, &out[r])) m = r;
+                if (m == at) break;
+                out[at] = out[m]; at = m;
             }
+            out[at] = all[i];
         }
     }
-    fclose(fp);
-    if (aggc == 0) { printf("No items sold yet.\n"); return; }
-    for (int i=0;i<aggc-1;++i) for (int j=i+1;j<aggc;++j) {
-        if (agg[j].qty > agg[i].qty || (agg[j].qty == agg[i].qty && agg[j].revenue > agg[i].revenue)) {
-            Agg tmp = agg[i]; agg[i] = agg[j]; agg[j] = tmp;
+    qsort(out, h, sizeof(TopSeller), top_seller_cmp);
+    return h;
+}
+
+/* Display name for each ranked product: the catalog name, or for products
+   no longer in the catalog the name they were last sold under. */
+static void top_sellers_names(const TopSeller *top, int n, const char *names[]) {
+    Catalog *c = catalog_get();
+    int missing = 0;
+    for (int i = 0; i < n; ++i) {
+        int idx = catalog_find(top[i].code);
+        names[i] = idx >= 0 ? catalog_name(c, idx) : NULL;
+        if (!names[i]) missing++;
+    }
+    SalesStore *ss = missing ? sales_store_get() : NULL;
+    if (ss && sales_dicts_load()) {
+        const int32_t *code = sales_column(SC_CODE), *item = sales_column(SC_ITEM);
+        for (uint32_t r = ss->meta.rows; r-- > 0 && missing > 0; ) {
+            for (int i = 0; i < n; ++i) {
+                if (names[i] || top[i].code != code[r]) continue;
+                names[i] = dict_str(&ss->dict[SD_ITEM], item[r]);
+                missing--;
+            }
         }
     }
-    int top = aggc < 10 ? aggc : 10;
-    printf("Top %d selling products:\n", top);
+    for (int i = 0; i < n; ++i) if (!names[i]) names[i] = "-";
+}
+
+static void top_sellers_print(const TopSeller *top, int n, const char *scope) {
+    const char **names = xrealloc(NULL, sizeof(char *) * (n ? n : 1));
+    top_sellers_names(top, n, names);
+    printf("Top %d selling products%s:\n", n, scope);
     printf("Rank | Code | Qty Sold | Revenue | Name\n");
     printf("---------------------------------------------------------\n");
-    for (int i=0;i<top;++i) {
-        printf("%4d | %4d | %8ld | %8.2f | %s\n", i+1, agg[i].code, agg[i].qty, agg[i].revenue, agg[i].name);
+    char amt[CENTS_CHARS];
+    for (int i = 0; i < n; ++i)
+        printf("%4d | %4d | %8lld | %8s | %s\n", i+1, top[i].code, top[i].qty, cents_str(amt, top[i].revenue), names[i]);
+    free(names);
+}
+
+void report_top_selling() {
+    char buf[64];
+    int k = 10, lo = 0, hi = INT_MAX, dlo, dhi;
+    printf("How many products (blank for 10): ");
+    fgets(buf, sizeof(buf), stdin); trimnewline(buf);
+    if (strlen(buf) && (sscanf(buf, "%d", &k) != 1 || k <= 0)) { printf("Invalid.\n"); return; }
+    printf("From date YYYY-MM-DD (blank for all time): ");
+    fgets(buf, sizeof(buf), stdin); trimnewline(buf);
+    if (strlen(buf)) {
+        if (!date_range(buf, &dlo, &dhi)) { printf("Invalid.\n"); return; }
+        lo = dlo;
+        printf("To date YYYY-MM-DD (blank for open-ended): ");
+        fgets(buf, sizeof(buf), stdin); trimnewline(buf);
+        if (strlen(buf)) { if (!date_range(buf, &dlo, &dhi)) { printf("Invalid.\n"); return; } hi = dhi; }
+    }
+    char category[64];
+    printf("Category (blank for all, * for each category): ");
+    fgets(category, sizeof(category), stdin); trimnewline(category);
+    int catId = -1;
+    Catalog *c = catalog_get();
+    if (strlen(category) && strcmp(category, "*") != 0) {
+        catId = dict_find(&c->categories, category);
+        if (catId < 0) { printf("Unknown category.\n"); return; }
+    }
+    if (receipt_log_size() < 0) { printf("No items sold yet.\n"); return; }
+
+    TopSeller *all, *top;
+    int n = top_sellers_aggregate(lo, hi, &all);
+    if (n == 0) { printf(lo > 0 || hi < INT_MAX ? "No items sold in that period.\n" : "No items sold yet.\n"); free(all); return; }
+    top = xrealloc(NULL, sizeof(TopSeller) * (k < n ? k : n));
+    if (strcmp(category, "*") == 0) {
+        for (int id = 0; id < c->categories.count; ++id) {
+            int m = top_sellers_select(all, n, id, k, top);
+            if (m == 0) continue;
+            char scope[96]; snprintf(scope, sizeof(scope), " in %s", dict_str(&c->categories, id));
+            top_sellers_print(top, m, scope);
+            printf("\n");
+        }
+    } else {
+        char scope[96] = "";
+        if (catId >= 0) snprintf(scope, sizeof(scope), " in %s", category);
+        top_sellers_print(top, top_sellers_select(all, n, catId, k, top), scope);
+    }
+    free(top);
+    free(all);
+}
+
+/* Lines of one product within a date range, gathered per scan chunk and
+   printed in log order by the merge. */
+typedef struct {
+    TextBuf text;
+    int lines;
+    long long qty;
+    Money revenue;
+} ProductReceiptChunk;
+
+typedef struct {
+    int code, fromDay, toDay;
+    int kept;       // sealed segments scanned
+    ProductReceiptChunk *chunk;
+    int lines;
+    long long qty;
+    Money revenue;
+} ProductReceiptScan;
+
+static int product_receipts_keep(const ReceiptZone *z, void *ctx) {
+    ProductReceiptScan *q = ctx;
+    int keep = receipt_zone_may_match(z, q->fromDay, q->toDay, q->code);
+    q->kept += keep;
+    return keep;
+}
+
+static int product_receipts_chunk(CsvReader *r, long long end, int chunk, void *arg) {
+    ProductReceiptScan *q = arg;
+    ProductReceiptChunk *k = &q->chunk[chunk];
+    ReceiptLine x;
+    int day, tod;
+    char amt[CENTS_CHARS];
+    while (csv_tell(r) < end && csv_next(r, CSV_MAX_FIELDS) > 0) {
+        if (!receipt_parse(r, &x) || x.code != q->code || !iso_parse(x.iso, &day, &tod)) continue;
+        if ((q->fromDay && day < q->fromDay) || (q->toDay && day > q->toDay)) continue;
+        tb_printf(&k->text, "ReceiptID: %d | Date: %.*s | Customer: %.*s | Qty: %d | Total: %s\n",
+                  x.rid, x.iso.len, x.iso.p, x.customer.len, x.customer.p, x.qty, cents_str(amt, x.subtotal));
+        k->lines++;
+        k->qty += x.qty;
+        k->revenue += x.subtotal;
     }
+    return 1;
+}
+
+static int product_receipts_merge(int chunk, int ok, void *arg) {
+    ProductReceiptScan *q = arg;
+    ProductReceiptChunk *k = &q->chunk[chunk];
+    if (ok && k->text.len) fwrite(k->text.data, 1, k->text.len, stdout);
+    q->lines += k->lines;
+    q->qty += k->qty;
+    q->revenue += k->revenue;
+    free(k->text.data);
+    return 1;
+}
+
+/* Every receipt line of a product, reading only the sealed segments whose
+   zone maps allow the product and date range. */
+void report_product_receipts() {
+    ProductReceiptScan q;
+    char from[16], to[16];
+    int unused;
+    memset(&q, 0, sizeof(q));
+    printf("Enter product code: ");
+    if (scanf("%d", &q.code) != 1) { while(getchar()!='\n'); printf("Invalid.\n"); return; }
+    while(getchar()!='\n');
+    printf("From date (YYYY[-MM[-DD]], blank for any): ");
+    fgets(from, sizeof(from), stdin); trimnewline(from);
+    if (from[0] && !date_range(from, &q.fromDay, &unused)) { printf("Invalid date.\n"); return; }
+    printf("To date (YYYY[-MM[-DD]], blank for any): ");
+    fgets(to, sizeof(to), stdin); trimnewline(to);
+    if (to[0] && !date_range(to, &unused, &q.toDay)) { printf("Invalid date.\n"); return; }
+    long long size = receipt_log_size();
+    if (size < 0) { printf("No receipts.\n"); return; }
+
+    ParallelScan s;
+    if (!receipt_log_split(&s, 0, size, product_receipts_keep, &q)) { printf("File error.\n"); return; }
+    q.chunk = xrealloc(NULL, sizeof(ProductReceiptChunk) * (size_t)s.chunks);
+    memset(q.chunk, 0, sizeof(ProductReceiptChunk) * (size_t)s.chunks);
+    int ok = scan_run(&s, product_receipts_chunk, product_receipts_merge, &q);
+    free(q.chunk);
+    scan_free(&s);
+    if (!ok) printf("File error; the list may be incomplete.\n");
+    if (q.lines == 0) printf("No receipts with product %d in that period.\n", q.code);
+    else {
+        char amt[CENTS_CHARS];
+        printf("%d lines | qty %lld | total %s\n", q.lines, q.qty, cents_str(amt, q.revenue));
+    }
+    printf("Read %d of %d sealed segments and %s.\n", q.kept, receipt_log_get()->count, RECEIPTS_FILE);
+}
+
+/* One "code,name,qty,unit,subtotal,timestamp" line per receipt line, the
+   layout checkouts used to append to sales_items.txt. */
+typedef struct {
+    FILE *fp;
+    TextBuf *text;  // per chunk
+    long long lines;
+} SalesItemsExport;
+
+static int sales_items_chunk(CsvReader *r, long long end, int chunk, void *arg) {
+    SalesItemsExport *x = arg;
+    ReceiptLine rl;
+    char unit[CENTS_CHARS], amt[CENTS_CHARS];
+    while (csv_tell(r) < end && csv_next(r, CSV_MAX_FIELDS) > 0) {
+        if (!receipt_parse(r, &rl)) continue;
+        tb_printf(&x->text[chunk], "%d,%.*s,%d,%s,%s,%.*s\n", rl.code, rl.name.len, rl.name.p, rl.qty,
+                  cents_str(unit, rl.unit), cents_str(amt, rl.subtotal), rl.iso.len, rl.iso.p);
+    }
+    return 1;
+}
+
+static int sales_items_merge(int chunk, int ok, void *arg) {
+    SalesItemsExport *x = arg;
+    TextBuf *b = &x->text[chunk];
+    if (ok && b->len && fwrite(b->data, 1, b->len, x->fp) != b->len) ok = 0;
+    for (size_t i = 0; ok && i < b->len; ++i) x->lines += b->data[i] == '\n';
+    free(b->data);
+    return ok;
+}
+
+/* Writes the receipt log out as sales_items.txt lines. */
+int sales_items_export(const char *path) {
+    long long size = receipt_log_size();
+    if (size < 0) { printf("No receipts.\n"); return 0; }
+    SalesItemsExport x;
+    memset(&x, 0, sizeof(x));
+    ParallelScan s;
+    if (!receipt_log_split(&s, 0, size, NULL, NULL)) { printf("File error.\n"); return 0; }
+    if ((x.fp = fopen(path, "w")) == NULL) { scan_free(&s); printf("Cannot write %s\n", path); return 0; }
+    setvbuf(x.fp, NULL, _IOFBF, 1 << 20);
+    x.text = xrealloc(NULL, sizeof(TextBuf) * (size_t)s.chunks);
+    memset(x.text, 0, sizeof(TextBuf) * (size_t)s.chunks);
+    int ok = scan_run(&s, sales_items_chunk, sales_items_merge, &x);
+    free(x.text);
+    scan_free(&s);
+    if (fclose(x.fp) != 0) ok = 0;
+    if (!ok) { printf("Could not write %s.\n", path); return 0; }
+    printf("Exported %lld sales lines to %s.\n", x.lines, path);
+    return 1;
 }
 
 /* ---------- Customer Management Prototypes ---------- */
@@ -727,131 +5098,503 @@ void register_customer();
 void update_customer();
 void search_customer();
 void fetch_receipt_history();
+int customer_search(const char *term, Customer out[], int max);
+CustomerStore* customer_store_get();
+int customer_read(int slot, Customer *c);
+int customer_find_id(int id);
+int customer_find_phone(const char *phone, int out[], int max);
+int customer_find_name(const char *prefix, int out[], int max);
+int customer_add(Customer *c);
+int customer_update(int slot, const Customer *c);
+int customers_import_csv(const char *path);
+int customers_export_csv(const char *path);
+int customer_receipts(const char *name, int fromDay, int toDay, int skip, int limit,
+                      void (*visit)(const ReceiptLine *x, void *ctx), void *ctx);
 
 /* ---------- Customer Management Implementation ---------- */
-int next_customer_id() {
-    FILE *fp = fopen("customers.txt", "r");
-    int id = 1, last = 0;
-    if (fp) {
-        while (fscanf(fp, "%d,%*[^,],%*[^,],%*[^,],%*[^,\n]\n", &id) == 1)
-            last = id;
-        fclose(fp);
+/* customers.txt: id,name,phone,email,address; the address runs to the end
+   of the line. Returns the number of fields read into c. */
+static int customer_parse(const CsvReader *r, Customer *c) {
+    memset(c, 0, sizeof(*c));
+    if (!field_int(r->f[0], &c->id)) return 0;
+    if (r->nf > 1) field_copy(r->f[1], c->name, sizeof(c->name));
+    if (r->nf > 2) field_copy(r->f[2], c->phone, sizeof(c->phone));
+    if (r->nf > 3) field_copy(r->f[3], c->email, sizeof(c->email));
+    if (r->nf > 4) field_copy(r->f[4], c->address, sizeof(c->address));
+    return r->nf;
+}
+
+static CustomerStore g_customers;
+
+/* Last 10 digits of a phone number, ignoring spaces, dashes and a +91
+   prefix; 0 if it has no digits. */
+static uint64_t phone_key(const char *phone) {
+    uint64_t key = 0;
+    int digits = 0;
+    for (; *phone; ++phone) if (*phone >= '0' && *phone <= '9') { key = key * 10 + (uint64_t)(*phone - '0'); digits++; }
+    if (digits > 10) key %= 10000000000ull;
+    return digits ? key + 1 : 0;    // +1 so an all-zero number is still a key
+}
+
+static unsigned customer_hash(uint64_t key) {
+    return (unsigned)((key * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
+static void customer_index_put(int *table, uint64_t key, int slot) {
+    unsigned mask = (unsigned)g_customers.indexCap - 1, h = customer_hash(key) & mask;
+    while (table[h] >= 0) h = (h + 1) & mask;
+    table[h] = slot;
+}
+
+static void customer_index_rebuild() {
+    CustomerStore *cs = &g_customers;
+    int cap = 16;
+    while (cap < cs->count * 2) cap <<= 1;
+    if (cap != cs->indexCap) {
+        cs->idIndex = xrealloc(cs->idIndex, sizeof(int) * cap);
+        cs->phoneIndex = xrealloc(cs->phoneIndex, sizeof(int) * cap);
+        cs->indexCap = cap;
+    }
+    for (int i = 0; i < cap; ++i) cs->idIndex[i] = cs->phoneIndex[i] = -1;
+    for (int i = 0; i < cs->count; ++i) {
+        customer_index_put(cs->idIndex, (uint64_t)(uint32_t)cs->id[i], i);
+        if (cs->phone[i]) customer_index_put(cs->phoneIndex, cs->phone[i], i);
+    }
+}
+
+static const char* customer_name_key(int slot) {
+    return g_customers.names + g_customers.nameOff[slot];
+}
+
+static int name_key_cmp(const void *a, const void *b) {
+    const NameKey *x = a, *y = b;
+    int c = strcmp(customer_name_key(x->slot) + x->off, customer_name_key(y->slot) + y->off);
+    return c ? c : (x->slot > y->slot) - (x->slot < y->slot);
+}
+
+static void name_keys_of(int slot, void (*add)(int slot, int off)) {
+    const char *n = customer_name_key(slot);
+    for (int i = 0; n[i]; ++i)
+        if (n[i] != ' ' && (i == 0 || n[i-1] == ' ')) add(slot, i);
+}
+
+static void name_key_append(int slot, int off) {
+    CustomerStore *cs = &g_customers;
+    if (cs->nameKeys == cs->nameKeysCap) {
+        cs->nameKeysCap = cs->nameKeysCap ? cs->nameKeysCap * 2 : 1024;
+        cs->byName = xrealloc(cs->byName, sizeof(NameKey) * cs->nameKeysCap);
+    }
+    cs->byName[cs->nameKeys].slot = slot;
+    cs->byName[cs->nameKeys++].off = off;
+}
+
+/* First name key not below key, or with upper set, the first whose first
+   prefixLen bytes sort above it (binary search). */
+static int name_key_bound(const char *key, size_t prefixLen, int upper) {
+    int lo = 0, hi = g_customers.nameKeys;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        const NameKey *k = &g_customers.byName[mid];
+        int c = prefixLen ? strncmp(customer_name_key(k->slot) + k->off, key, prefixLen) : strcmp(customer_name_key(k->slot) + k->off, key);
+        if (c < 0 || (upper && c == 0)) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+static void name_key_insert(int slot, int off) {
+    CustomerStore *cs = &g_customers;
+    name_key_append(slot, off);     // grows the array; then move into place
+    NameKey k = cs->byName[--cs->nameKeys];
+    int at = name_key_bound(customer_name_key(slot) + off, 0, 0);
+    while (at < cs->nameKeys && name_key_cmp(&cs->byName[at], &k) < 0) at++;
+    memmove(&cs->byName[at + 1], &cs->byName[at], sizeof(NameKey) * (size_t)(cs->nameKeys - at));
+    cs->byName[at] = k;
+    cs->nameKeys++;
+}
+
+static void customer_name_index_build() {
+    CustomerStore *cs = &g_customers;
+    cs->nameKeys = 0;
+    for (int i = 0; i < cs->count; ++i) name_keys_of(i, name_key_append);
+    qsort(cs->byName, (size_t)cs->nameKeys, sizeof(NameKey), name_key_cmp);
+    cs->nameIndexed = 1;
+}
+
+/* Adds slot's id, phone and name to the resident arrays. */
+static void customer_track(int slot, const Customer *c) {
+    CustomerStore *cs = &g_customers;
+    if (slot >= cs->cap) {
+        cs->cap = cs->cap ? cs->cap * 2 : 1024;
+        while (cs->cap <= slot) cs->cap *= 2;
+        cs->id = xrealloc(cs->id, sizeof(int32_t) * cs->cap);
+        cs->phone = xrealloc(cs->phone, sizeof(uint64_t) * cs->cap);
+        cs->nameOff = xrealloc(cs->nameOff, sizeof(uint32_t) * cs->cap);
+    }
+    size_t len = strnlen(c->name, sizeof(c->name));
+    if (cs->namesLen + len + 1 > cs->namesCap) {
+        while (cs->namesLen + len + 1 > cs->namesCap) cs->namesCap = cs->namesCap ? cs->namesCap * 2 : 1 << 16;
+        cs->names = xrealloc(cs->names, cs->namesCap);
+    }
+    cs->id[slot] = c->id;
+    cs->phone[slot] = phone_key(c->phone);
+    cs->nameOff[slot] = (uint32_t)cs->namesLen;
+    for (size_t i = 0; i < len; ++i) cs->names[cs->namesLen++] = (char)tolower((unsigned char)c->name[i]);
+    cs->names[cs->namesLen++] = '\0';
+    if (slot >= cs->count) cs->count = slot + 1;
+    if (c->id > cs->lastId) cs->lastId = c->id;
+}
+
+static int customer_write_header() {
+    CustomerFileHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, CUSTOMER_MAGIC, sizeof(CUSTOMER_MAGIC));
+    h.version = CUSTOMER_VERSION;
+    h.recordSize = sizeof(Customer);
+    h.count = (uint32_t)g_customers.count;
+    h.lastId = g_customers.lastId;
+    FILE *fp = g_customers.fp;
+    return fp && fseek(fp, 0, SEEK_SET) == 0 && fwrite(&h, sizeof(h), 1, fp) == 1 && fflush(fp) == 0;
+}
+
+static int customer_seek(int slot) {
+    return file_seek(g_customers.fp, (long long)sizeof(CustomerFileHeader) + (long long)slot * (long long)sizeof(Customer));
+}
+
+/* Builds customers.dat from the CSV at path (written to .tmp, then
+   renamed). Returns the number of customers, or -1. */
+int customers_import_csv(const char *path) {
+    CsvReader r;
+    if (!csv_open(&r, path)) { printf("Cannot read %s\n", path); return -1; }
+    char tmp[64];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", CUSTOMERS_DB_FILE);
+    FILE *fp = fopen(tmp, "wb");
+    if (!fp) { csv_close(&r); printf("Cannot write %s\n", tmp); return -1; }
+    CustomerFileHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, CUSTOMER_MAGIC, sizeof(CUSTOMER_MAGIC));
+    h.version = CUSTOMER_VERSION;
+    h.recordSize = sizeof(Customer);
+    int ok = fwrite(&h, sizeof(h), 1, fp) == 1;
+    Customer c;
+    while (ok && csv_next(&r, 5) > 0) {
+        if (customer_parse(&r, &c) < 2) continue;
+        ok = fwrite(&c, sizeof(c), 1, fp) == 1;
+        h.count++;
+        if (c.id > h.lastId) h.lastId = c.id;
+    }
+    csv_close(&r);
+    ok = ok && fseek(fp, 0, SEEK_SET) == 0 && fwrite(&h, sizeof(h), 1, fp) == 1 && sync_file(fp);
+    if (fclose(fp) != 0) ok = 0;
+    if (ok) { remove(CUSTOMERS_DB_FILE); ok = rename(tmp, CUSTOMERS_DB_FILE) == 0; }
+    if (!ok) { remove(tmp); printf("Failed to import %s\n", path); return -1; }
+    if (g_customers.loaded) {   // reload from the new file
+        if (g_customers.fp) fclose(g_customers.fp);
+        g_customers.fp = NULL;
+        g_customers.loaded = 0;
+    }
+    return (int)h.count;
+}
+
+int customers_export_csv(const char *path) {
+    CustomerStore *cs = customer_store_get();
+    FILE *fp = fopen(path, "w");
+    if (!fp) { printf("Cannot write %s\n", path); return 0; }
+    Customer c;
+    for (int i = 0; i < cs->count; ++i)
+        if (customer_read(i, &c)) fprintf(fp, "%d,%s,%s,%s,%s\n", c.id, c.name, c.phone, c.email, c.address);
+    return fclose(fp) == 0;
+}
+
+/* Opens customers.dat, importing customers.txt the first time, and builds
+   the id and phone indexes. */
+CustomerStore* customer_store_get() {
+    CustomerStore *cs = &g_customers;
+    if (cs->loaded) return cs;
+    // before loaded is set, so the import has no half-loaded store to reset
+    if (file_size(CUSTOMERS_DB_FILE) < 0 && file_size(CUSTOMERS_FILE) >= 0) {
+        int n = customers_import_csv(CUSTOMERS_FILE);
+        if (n >= 0) printf("Imported %d customers from %s into %s.\n", n, CUSTOMERS_FILE, CUSTOMERS_DB_FILE);
+    }
+    cs->loaded = 1;
+    cs->count = cs->lastId = 0;
+    cs->namesLen = 0;
+    cs->nameKeys = cs->nameIndexed = 0;
+    cs->fp = fopen(CUSTOMERS_DB_FILE, "r+b");
+    CustomerFileHeader h;
+    if (cs->fp && (fread(&h, sizeof(h), 1, cs->fp) != 1 || memcmp(h.magic, CUSTOMER_MAGIC, sizeof(CUSTOMER_MAGIC)) != 0
+                   || h.version != CUSTOMER_VERSION || h.recordSize != sizeof(Customer))) {
+        printf("Warning: %s is not a customer store; leaving it untouched.\n", CUSTOMERS_DB_FILE);
+        fclose(cs->fp);
+        cs->fp = NULL;
+    }
+    if (!cs->fp) {
+        if (file_size(CUSTOMERS_DB_FILE) < 0 && (cs->fp = fopen(CUSTOMERS_DB_FILE, "w+b")) != NULL) customer_write_header();
+        customer_index_rebuild();
+        return cs;
+    }
+    Customer c;
+    for (uint32_t i = 0; i < h.count && fread(&c, sizeof(c), 1, cs->fp) == 1; ++i) customer_track((int)i, &c);
+    if (h.lastId > cs->lastId) cs->lastId = h.lastId;
+    customer_index_rebuild();
+    return cs;
+}
+
+int customer_read(int slot, Customer *c) {
+    CustomerStore *cs = customer_store_get();
+    if (slot < 0 || slot >= cs->count || !cs->fp) return 0;
+    return customer_seek(slot) && fread(c, sizeof(*c), 1, cs->fp) == 1;
+}
+
+int customer_find_id(int id) {
+    CustomerStore *cs = customer_store_get();
+    unsigned mask = (unsigned)cs->indexCap - 1, h = customer_hash((uint64_t)(uint32_t)id) & mask;
+    int slot;
+    while ((slot = cs->idIndex[h]) != -1) {
+        if (slot >= 0 && cs->id[slot] == id) return slot;
+        h = (h + 1) & mask;
+    }
+    return -1;
+}
+
+/* Slots whose phone normalizes to the same number. */
+int customer_find_phone(const char *phone, int out[], int max) {
+    CustomerStore *cs = customer_store_get();
+    uint64_t key = phone_key(phone);
+    if (!key) return 0;
+    unsigned mask = (unsigned)cs->indexCap - 1, h = customer_hash(key) & mask;
+    int slot, n = 0;
+    while ((slot = cs->phoneIndex[h]) != -1) {
+        if (slot >= 0 && cs->phone[slot] == key) { if (n < max) out[n] = slot; n++; }
+        h = (h + 1) & mask;
+    }
+    return n;
+}
+
+/* Slots with a name word starting with prefix (case-insensitive), in name
+   order. Fills up to max and returns the number of matches, counting a
+   customer twice if two of their name words match. */
+int customer_find_name(const char *prefix, int out[], int max) {
+    CustomerStore *cs = customer_store_get();
+    char key[sizeof(((Customer *)0)->name)];
+    size_t len = 0;
+    while (*prefix == ' ') prefix++;
+    for (; prefix[len] && len < sizeof(key) - 1; ++len) key[len] = (char)tolower((unsigned char)prefix[len]);
+    while (len > 0 && key[len-1] == ' ') len--;
+    key[len] = '\0';
+    if (len == 0) return 0;
+    if (!cs->nameIndexed) customer_name_index_build();
+    int lo = name_key_bound(key, len, 0), hi = name_key_bound(key, len, 1), n = 0;
+    for (int i = lo; i < hi && n < max; ++i) {
+        int slot = cs->byName[i].slot, dup = 0;
+        for (int j = 0; j < n; ++j) if (out[j] == slot) dup = 1;
+        if (!dup) out[n++] = slot;
+    }
+    return n < max ? n : hi - lo;
+}
+
+/* Assigns c->id, appends the record and returns its slot, or -1. The
+   record is written before the header that counts it. */
+int customer_add(Customer *c) {
+    CustomerStore *cs = customer_store_get();
+    if (!cs->fp) return -1;
+    int slot = cs->count;
+    c->id = cs->lastId + 1;
+    if (!customer_seek(slot) || fwrite(c, sizeof(*c), 1, cs->fp) != 1 || fflush(cs->fp) != 0) return -1;
+    customer_track(slot, c);
+    if (!customer_write_header()) return -1;
+    if (cs->count * 2 > cs->indexCap) customer_index_rebuild();
+    else {
+        customer_index_put(cs->idIndex, (uint64_t)(uint32_t)c->id, slot);
+        if (cs->phone[slot]) customer_index_put(cs->phoneIndex, cs->phone[slot], slot);
+    }
+    if (cs->nameIndexed) name_keys_of(slot, name_key_insert);
+    return slot;
+}
+
+/* Rewrites one record in place; the id and name are kept. */
+int customer_update(int slot, const Customer *c) {
+    CustomerStore *cs = customer_store_get();
+    if (slot < 0 || slot >= cs->count || !cs->fp) return 0;
+    Customer rec = *c;
+    rec.id = cs->id[slot];
+    if (!customer_seek(slot) || fwrite(&rec, sizeof(rec), 1, cs->fp) != 1 || fflush(cs->fp) != 0) return 0;
+    uint64_t key = phone_key(rec.phone);
+    if (key != cs->phone[slot]) {
+        if (cs->phone[slot]) {
+            unsigned mask = (unsigned)cs->indexCap - 1, h = customer_hash(cs->phone[slot]) & mask;
+            while (cs->phoneIndex[h] != slot) h = (h + 1) & mask;
+            cs->phoneIndex[h] = -2;
+        }
+        cs->phone[slot] = key;
+        if (key) customer_index_put(cs->phoneIndex, key, slot);
     }
-    return last + 1;
+    return 1;
 }
 
 void register_customer() {
-    FILE *fp = fopen("customers.txt", "a");
-    if (!fp) { printf("Could not open customers.txt\n"); return; }
     Customer c;
-    c.id = next_customer_id();
+    memset(&c, 0, sizeof(c));
+    if (!customer_store_get()->fp) { printf("Could not open %s\n", CUSTOMERS_DB_FILE); return; }
     printf("Enter Name: "); fgets(c.name, sizeof(c.name), stdin); trimnewline(c.name);
     printf("Enter Phone: "); fgets(c.phone, sizeof(c.phone), stdin); trimnewline(c.phone);
     printf("Enter Email: "); fgets(c.email, sizeof(c.email), stdin); trimnewline(c.email);
     printf("Enter Address: "); fgets(c.address, sizeof(c.address), stdin); trimnewline(c.address);
-    fprintf(fp, "%d,%s,%s,%s,%s\n", c.id, c.name, c.phone, c.email, c.address);
-    fclose(fp);
-    printf("Customer registered.\n");
+    if (customer_add(&c) < 0) { printf("Could not write %s\n", CUSTOMERS_DB_FILE); return; }
+    printf("Customer registered with ID %d.\n", c.id);
 }
 
-void update_customer() {
-    char search[50], nameLower[50], custNameLower[50];
-    int found = 0, updateChoice;
-    printf("Enter customer name to update: ");
-    fgets(search, sizeof(search), stdin); trimnewline(search);
-    strncpy(nameLower, search, sizeof(nameLower)); strtolower(nameLower);
+/* Customers with this id or phone, or a name word starting with term
+   (case-insensitive). Fills up to max and returns the number of matches,
+   or -1 if the store cannot be opened. */
+int customer_search(const char *term, Customer out[], int max) {
+    CustomerStore *cs = customer_store_get();
+    if (!cs->fp) return -1;
+    int slots[SEARCH_MAX_RESULTS], n = 0, id;
+    char *end;
+    id = (int)strtol(term, &end, 10);
+    int numeric = end != term && *end == '\0';
+    if (numeric && (id = customer_find_id(id)) >= 0) slots[n++] = id;
+    int more = customer_find_phone(term, slots + n, SEARCH_MAX_RESULTS - n);
+    int total = n + more;
+    n += more < SEARCH_MAX_RESULTS - n ? more : SEARCH_MAX_RESULTS - n;
+    if (!numeric) {
+        more = customer_find_name(term, slots + n, SEARCH_MAX_RESULTS - n);
+        total += more;
+        n += more < SEARCH_MAX_RESULTS - n ? more : SEARCH_MAX_RESULTS - n;
+    }
+    int m = 0;
+    for (int i = 0; i < n && m < max; ++i) {
+        int dup = 0;
+        for (int j = 0; j < i; ++j) if (slots[j] == slots[i]) dup = 1;
+        if (dup) { total--; continue; }
+        if (customer_read(slots[i], &out[m])) m++;
+    }
+    return total < m ? m : total;
+}
 
-    FILE *fp = fopen("customers.txt", "r");
-    FILE *temp = fopen("customers_temp.txt", "w");
-    if (!fp || !temp) { printf("File error.\n"); return; }
+static void print_customer_row(const Customer *c) {
+    printf("| %-2d | %-20s | %-13s | %-25s | %-24s |\n", c->id, c->name, c->phone, c->email, c->address);
+}
+
+/* Prompts for an id, phone or name and returns the chosen slot, or -1. */
+static int customer_pick(const char *prompt) {
+    char search[50];
+    Customer hits[SEARCH_MAX_RESULTS];
+    printf("%s", prompt);
+    fgets(search, sizeof(search), stdin); trimnewline(search);
+    int found = customer_search(search, hits, SEARCH_MAX_RESULTS);
+    if (found < 0) { printf("File error.\n"); return -1; }
+    if (found == 0) { printf("Customer not found.\n"); return -1; }
+    int id = hits[0].id;
+    if (found > 1) {
+        for (int i = 0; i < found && i < SEARCH_MAX_RESULTS; ++i) print_customer_row(&hits[i]);
+        printf("Several customers match; enter the ID: ");
+        if (scanf("%d", &id) != 1) id = -1;
+        while (getchar() != '\n');
+    }
+    int slot = customer_find_id(id);
+    if (slot < 0) printf("Customer not found.\n");
+    return slot;
+}
 
+void update_customer() {
+    int updateChoice;
+    int slot = customer_pick("Enter customer ID, phone or name to update: ");
     Customer c;
-    while (fscanf(fp, "%d,%49[^,],%14[^,],%49[^,],%99[^\n]\n", &c.id, c.name, c.phone, c.email, c.address) == 5) {
-        strncpy(custNameLower, c.name, sizeof(custNameLower)); strtolower(custNameLower);
-        if (strcmp(nameLower, custNameLower) == 0) {
-            found = 1;
-            printf("What do you want to update?\n");
-            printf("1. Phone\n2. Email\n3. Address\nEnter choice: ");
-            scanf("%d", &updateChoice); while(getchar()!='\n');
-            switch (updateChoice) {
-                case 1:
-                    printf("Enter new phone: "); fgets(c.phone, sizeof(c.phone), stdin); trimnewline(c.phone); break;
-                case 2:
-                    printf("Enter new email: "); fgets(c.email, sizeof(c.email), stdin); trimnewline(c.email); break;
-                case 3:
-                    printf("Enter new address: "); fgets(c.address, sizeof(c.address), stdin); trimnewline(c.address); break;
-                default:
-                    printf("Invalid choice. No update performed.\n");
-            }
-            printf("Customer updated.\n");
-        }
-        fprintf(temp, "%d,%s,%s,%s,%s\n", c.id, c.name, c.phone, c.email, c.address);
+    if (slot < 0 || !customer_read(slot, &c)) return;
+    printf("What do you want to update?\n");
+    printf("1. Phone\n2. Email\n3. Address\nEnter choice: ");
+    if (scanf("%d", &updateChoice) != 1) updateChoice = -1;
+    while(getchar()!='\n');
+    switch (updateChoice) {
+        case 1:
+            printf("Enter new phone: "); fgets(c.phone, sizeof(c.phone), stdin); trimnewline(c.phone); break;
+        case 2:
+            printf("Enter new email: "); fgets(c.email, sizeof(c.email), stdin); trimnewline(c.email); break;
+        case 3:
+            printf("Enter new address: "); fgets(c.address, sizeof(c.address), stdin); trimnewline(c.address); break;
+        default:
+            printf("Invalid choice. No update performed.\n"); return;
     }
-    fclose(fp); fclose(temp);
-    remove("customers.txt");
-    rename("customers_temp.txt", "customers.txt");
-    if (!found) printf("Customer not found.\n");
+    if (customer_update(slot, &c)) printf("Customer updated.\n");
+    else printf("File error.\n");
 }
 
 void search_customer() {
-    char search[50], nameLower[50], phoneLower[15], custNameLower[50], custPhoneLower[15];
-    int found = 0, searchId = 0, isId = 0;
-    printf("Enter customer name, ID, or phone to search: ");
+    char search[50];
+    Customer hits[SEARCH_MAX_RESULTS];
+    printf("Enter customer ID, phone, or name to search: ");
     fgets(search, sizeof(search), stdin); trimnewline(search);
 
-    if (sscanf(search, "%d", &searchId) == 1) isId = 1;
-    strncpy(nameLower, search, sizeof(nameLower)-1); nameLower[sizeof(nameLower)-1] = '\0'; strtolower(nameLower);
-    strncpy(phoneLower, search, sizeof(phoneLower)-1); phoneLower[sizeof(phoneLower)-1] = '\0'; strtolower(phoneLower);
-
-    FILE *fp = fopen("customers.txt", "r");
-    if (!fp) { printf("File error.\n"); return; }
-    Customer c;
-    char line[512];
+    int found = customer_search(search, hits, SEARCH_MAX_RESULTS);
+    if (found < 0) { printf("File error.\n"); return; }
     printf("Results:\n");
     printf("+----+----------------------+---------------+---------------------------+--------------------------+\n");
     printf("| ID | Name                 | Phone         | Email                     | Address                  |\n");
     printf("+----+----------------------+---------------+---------------------------+--------------------------+\n");
-    while (fgets(line, sizeof(line), fp)) {
-        trimnewline(line);
-        memset(&c, 0, sizeof(c));
-        int fields = sscanf(line, "%d,%49[^,],%14[^,],%49[^,],%99[^\n]", &c.id, c.name, c.phone, c.email, c.address);
-        if (fields < 2) continue;
-        strncpy(custNameLower, c.name, sizeof(custNameLower)-1); custNameLower[sizeof(custNameLower)-1] = '\0'; strtolower(custNameLower);
-        strncpy(custPhoneLower, c.phone, sizeof(custPhoneLower)-1); custPhoneLower[sizeof(custPhoneLower)-1] = '\0'; strtolower(custPhoneLower);
-        if ((isId && c.id == searchId) ||
-            (strlen(nameLower) && strstr(custNameLower, nameLower)) ||
-            (strlen(phoneLower) && strstr(custPhoneLower, phoneLower))) {
-            printf("| %-2d | %-20s | %-13s | %-25s | %-24s |\n", c.id, c.name, c.phone, c.email, c.address);
-            found = 1;
-        }
-    }
+    for (int i = 0; i < found && i < SEARCH_MAX_RESULTS; ++i) print_customer_row(&hits[i]);
     printf("+----+----------------------+---------------+---------------------------+--------------------------+\n");
-    fclose(fp);
+    if (found > SEARCH_MAX_RESULTS) printf("... %d more matches, refine the search.\n", found - SEARCH_MAX_RESULTS);
     if (!found) printf("Customer not found.\n");
 }
 
+/* Calls visit for the lines of the named customer's (case-insensitive)
+   receipts dated within [fromDay, toDay], 0 leaving that end open, newest
+   first: skip receipts are passed over and at most limit (0 for all) are
+   read, each with one seek. Returns how many receipts are in the range,
+   or -1 if receipts cannot be read. */
+int customer_receipts(const char *name, int fromDay, int toDay, int skip, int limit,
+                      void (*visit)(const ReceiptLine *x, void *ctx), void *ctx) {
+    group_commit_flush();   // the index already covers queued checkouts
+    ReceiptIndex *ri = receipt_index_get();
+    CsvReader r;
+    int seg = -1;
+    if (receipt_log_size() < 0) return -1;
+    memset(&r, 0, sizeof(r));
+    int found = 0;
+    for (int i = ri->headCap ? ri->head[receipt_index_slot(customer_key(name, strlen(name)))] : -1; i >= 0; i = ri->prev[i]) {
+        const ReceiptIndexEntry *e = &ri->e[i];
+        if ((fromDay && e->day < fromDay) || (toDay && e->day > toDay)) continue;
+        if (found++ < skip || (limit && found > skip + limit) || !visit) continue;
+        if (!receipt_log_read_at(&r, &seg, e->offset, e->bytes)) continue;
+        ReceiptLine x;
+        while (csv_next(&r, CSV_MAX_FIELDS) > 0)
+            if (receipt_parse(&r, &x) && x.rid == e->rid && field_ieq(x.customer, name)) visit(&x, ctx);
+    }
+    if (seg >= 0) csv_close(&r);
+    return found;
+}
+
+static void print_receipt_line(const ReceiptLine *x, void *ctx) {
+    (void)ctx;
+    char unit[CENTS_CHARS], amt[CENTS_CHARS];
+    printf("ReceiptID: %d | Date: %.*s | Item: %.*s | Qty: %d | Price: %s | Total: %s\n",
+           x->rid, x->iso.len, x->iso.p, x->name.len, x->name.p, x->qty, cents_str(unit, x->unit), cents_str(amt, x->subtotal));
+}
+
 void fetch_receipt_history() {
-    char search[50], nameLower[50], receiptNameLower[50];
-    int found = 0, rid, itemId, qty;
-    char cname[50], date[32], itemName[128];
-    double price, itemTotal;
+    char search[50], from[16], to[16], more[8];
+    int lo = 0, hi = 0, unused;
     printf("Enter customer name to fetch receipt history: ");
     fgets(search, sizeof(search), stdin); trimnewline(search);
-    strncpy(nameLower, search, sizeof(nameLower)); strtolower(nameLower);
+    printf("From date (YYYY[-MM[-DD]], blank for any): ");
+    fgets(from, sizeof(from), stdin); trimnewline(from);
+    if (from[0] && !date_range(from, &lo, &unused)) { printf("Invalid date.\n"); return; }
+    printf("To date (YYYY[-MM[-DD]], blank for any): ");
+    fgets(to, sizeof(to), stdin); trimnewline(to);
+    if (to[0] && !date_range(to, &unused, &hi)) { printf("Invalid date.\n"); return; }
 
-    FILE *fp = fopen(RECEIPTS_FILE, "r");
-    if (!fp) { printf("File error.\n"); return; }
-    printf("Receipts:\n");
-    while (fscanf(fp, "%d,%49[^,],%31[^,],%d,%127[^,],%d,%lf,%lf\n", &rid, cname, date, &itemId, itemName, &qty, &price, &itemTotal) == 8) {
-        strncpy(receiptNameLower, cname, sizeof(receiptNameLower)); strtolower(receiptNameLower);
-        if (strcmp(nameLower, receiptNameLower) == 0) {
-            printf("ReceiptID: %d | Date: %s | Item: %s | Qty: %d | Price: %.2f | Total: %.2f\n",
-                   rid, date, itemName, qty, price, itemTotal);
-            found = 1;
-        }
+    if (receipt_log_size() < 0) { printf("File error.\n"); return; }
+    printf("Receipts (newest first):\n");
+    for (int skip = 0;; skip += HISTORY_PAGE) {
+        int total = customer_receipts(search, lo, hi, skip, HISTORY_PAGE, print_receipt_line, NULL);
+        if (total <= 0) { printf("No receipts found for this customer.\n"); return; }
+        int shown = total - skip < HISTORY_PAGE ? total - skip : HISTORY_PAGE;
+        printf("Receipts %d-%d of %d.\n", skip + 1, skip + shown, total);
+        if (skip + shown >= total) return;
+        printf("Press Enter for more, 0 to stop: ");
+        if (!fgets(more, sizeof(more), stdin) || more[0] == '0') return;
     }
-    fclose(fp);
-    if (!found) printf("No receipts found for this customer.\n");
 }
 
 void customer_menu() {
@@ -878,11 +5621,445 @@ void customer_menu() {
     }
 }
 
-void print_steady_bill_top(CartItem cart[], int cartCount, const char *customerName) {
-    billing_print_steady(cart, cartCount, customerName);
+void print_steady_bill_top(Lane *l) {
+    billing_print_steady(l);
+}
+
+/* ---------- Synthetic data and benchmarks ---------- */
+/* --gen-data writes a catalog, receipts and customers of the requested
+   size into a directory; --bench runs inside such a directory and prints
+   one JSON object per measurement so runs can be diffed by scripts. */
+
+static const char *const g_genBrand[] = { "Amul", "Tata", "Fortune", "Britannia", "Nestle", "Dabur", "Parle", "Haldiram",
+                                          "Surf", "Colgate", "Dove", "Lays", "Maggi", "Aashirvaad", "Kissan", "Mother Dairy" };
+static const char *const g_genVariant[] = { "Premium", "Classic", "Gold", "Lite", "Family", "Organic", "Masala", "Fresh" };
+static const char *const g_genSize[] = { "100g", "250g", "500g", "1kg", "5kg", "200ml", "500ml", "1L" };
+static const struct { const char *item, *category, *subcategory; } g_genKind[] = {
+    { "Basmati Rice", "Grocery", "Food" }, { "Tea", "Grocery", "Beverages" }, { "Butter", "Grocery", "Dairy" },
+    { "Biscuits", "Snacks", "Bakery" }, { "Noodles", "Grocery", "Food" }, { "Atta", "Grocery", "Food" },
+    { "Sunflower Oil", "Grocery", "Oils" }, { "Sugar", "Grocery", "Food" }, { "Soap", "Personal Care", "Bath" },
+    { "Shampoo", "Personal Care", "Hair" }, { "Toothpaste", "Personal Care", "Oral" }, { "Chips", "Snacks", "Namkeen" },
+    { "Mango Juice", "Beverages", "Juice" }, { "Ketchup", "Grocery", "Sauces" }, { "Coffee", "Beverages", "Hot Drinks" },
+    { "Paneer", "Grocery", "Dairy" }, { "Ghee", "Grocery", "Dairy" }, { "Toor Dal", "Grocery", "Pulses" },
+    { "Detergent", "Household", "Laundry" }, { "Dishwash Bar", "Household", "Kitchen" } };
+static const char *const g_genFirst[] = { "Aarav", "Vivaan", "Aditya", "Vihaan", "Arjun", "Sai", "Reyansh", "Krishna",
+                                          "Ishaan", "Rohan", "Ananya", "Diya", "Saanvi", "Aadhya", "Kavya", "Priya",
+                                          "Meera", "Isha", "Neha", "Pooja", "Rahul", "Amit", "Sneha", "Kiran" };
+static const char *const g_genLast[] = { "Sharma", "Verma", "Patel", "Shah", "Mehta", "Iyer", "Reddy", "Nair", "Gupta",
+                                         "Singh", "Kumar", "Joshi", "Desai", "Rao", "Das", "Bose", "Kulkarni", "Pillai" };
+#define GEN_COUNT(a) ((int)(sizeof(a) / sizeof((a)[0])))
+
+static void gen_product_name(int code, char *out, size_t cap) {
+    unsigned h = (unsigned)code * 2654435761u;
+    snprintf(out, cap, "%s %s %s %s", g_genBrand[h % GEN_COUNT(g_genBrand)], g_genVariant[(h >> 8) % GEN_COUNT(g_genVariant)],
+             g_genKind[code % GEN_COUNT(g_genKind)].item, g_genSize[(h >> 16) % GEN_COUNT(g_genSize)]);
+}
+
+static void gen_customer_name(int id, char *out, size_t cap) {
+    unsigned h = (unsigned)id * 2246822519u;
+    snprintf(out, cap, "%s %s", g_genFirst[h % GEN_COUNT(g_genFirst)], g_genLast[(h >> 8) % GEN_COUNT(g_genLast)]);
+}
+
+static FILE* gen_open(const char *dir, const char *name) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE *fp = fopen(path, "w");
+    if (!fp) printf("Cannot write %s\n", path);
+    else setvbuf(fp, NULL, _IOFBF, 1 << 20);
+    return fp;
+}
+
+/* Writes products.txt with skus products, customers.txt with customers
+   entries and receipts.txt with about receiptLines lines spread over the
+   last 365 days, all deterministic. */
+int gen_data(const char *dir, int skus, long long receiptLines, int customers) {
+    if (skus <= 0 || receiptLines < 0 || customers < 0) { printf("Invalid sizes.\n"); return 0; }
+    if (!make_dir(dir)) { printf("Cannot create %s\n", dir); return 0; }
+    unsigned seed = 88172645u;
+    char name[96];
+
+    FILE *fp = gen_open(dir, PRODUCTS_FILE);
+    if (!fp) return 0;
+    Money *price = xrealloc(NULL, sizeof(Money) * (size_t)skus);
+    int *disc = xrealloc(NULL, sizeof(int) * (size_t)skus);
+    char amt[CENTS_CHARS], unitText[CENTS_CHARS];
+    for (int code = 1; code <= skus; ++code) {
+        gen_product_name(code, name, sizeof(name));
+        price[code-1] = 1000 + next_rand(&seed) % 199000;
+        disc[code-1] = next_rand(&seed) % 4 ? 0 : (int)(next_rand(&seed) % 16) * 100;
+        fprintf(fp, "%d,%s,%s,%d,%s,%s,%s,%d\n", code, name, cents_str(amt, price[code-1]), 1000000, cents_str(unitText, disc[code-1]),
+                g_genKind[code % GEN_COUNT(g_genKind)].category, g_genKind[code % GEN_COUNT(g_genKind)].subcategory,
+                DEFAULT_REORDER_LEVEL);
+    }
+    int ok = fclose(fp) == 0;
+
+    if ((fp = gen_open(dir, CUSTOMERS_FILE)) == NULL) { free(price); free(disc); return 0; }
+    for (int id = 1; id <= customers; ++id) {
+        gen_customer_name(id, name, sizeof(name));
+        fprintf(fp, "%d,%s,9%09d,customer%d@example.com,%d MG Road Pune\n", id, name, (int)(next_rand(&seed) % 1000000000u), id, 1 + id % 500);
+    }
+    ok = fclose(fp) == 0 && ok;
+
+    if ((fp = gen_open(dir, RECEIPTS_FILE)) == NULL) { free(price); free(disc); return 0; }
+    time_t today = time(NULL);
+    struct tm first = *localtime(&today);
+    first.tm_mday -= 364; first.tm_hour = 0; first.tm_min = 0; first.tm_sec = 0; first.tm_isdst = -1;
+    char date[16] = "";
+    int day = -1, rid = 0;
+    for (long long line = 0; line < receiptLines; ) {
+        int d = (int)(line * 365 / receiptLines);
+        if (d != day) {
+            struct tm t = first;
+            t.tm_mday += d;
+            time_t dt = mktime(&t);
+            strftime(date, sizeof(date), "%Y-%m-%d", localtime(&dt));
+            day = d;
+        }
+        int secs = 9 * 3600 + (int)(line * 365 % receiptLines * 13 * 3600 / receiptLines);
+        int items = 1 + (int)(next_rand(&seed) % 6), cust = customers && next_rand(&seed) % 10 < 7 ? 1 + (int)(next_rand(&seed) % (unsigned)customers) : 0;
+        char who[96] = "Walk-in";
+        if (cust) gen_customer_name(cust, who, sizeof(who));
+        rid++;
+        for (int i = 0; i < items && line < receiptLines; ++i, ++line) {
+            int code = 1 + (int)(next_rand(&seed) % (unsigned)skus), qty = 1 + (int)(next_rand(&seed) % 3);
+            Money unit = money_discounted(price[code-1], disc[code-1]);
+            gen_product_name(code, name, sizeof(name));
+            fprintf(fp, "%d,%s,%s %02d:%02d:%02d,%d,%s,%d,%s,%s\n", rid, who, date, secs / 3600, secs / 60 % 60, secs % 60,
+                    code, name, qty, cents_str(unitText, unit), cents_str(amt, unit * qty));
+        }
+    }
+    ok = fclose(fp) == 0 && ok;
+    free(price); free(disc);
+    printf("%s: %d products, %d customers, %lld receipt lines in %d receipts\n", dir, skus, customers, receiptLines, rid);
+    return ok;
+}
+
+static double g_benchStart;
+
+static void bench_begin() { g_benchStart = now_seconds(); }
+
+/* Prints one result line; check is printed so results can't be optimised away. */
+static void bench_end(const char *name, long long ops, double check) {
+    double secs = now_seconds() - g_benchStart;
+    printf("{\"bench\":\"%s\",\"ops\":%lld,\"seconds\":%.6f,\"ns_per_op\":%.1f,\"check\":%.2f}\n",
+           name, ops, secs, ops > 0 ? secs * 1e9 / ops : 0.0, check);
+    fflush(stdout);
+}
+
+static void bench_count_receipt(const ReceiptLine *x, void *ctx) {
+    *(Money *)ctx += x->subtotal;
+}
+
+static void bench_checkouts(const char *name, int lanes, int perLane) {
+    StressLane *sl = xrealloc(NULL, sizeof(StressLane) * lanes);
+    thread_t *th = xrealloc(NULL, sizeof(thread_t) * lanes);
+    long long units = 0;
+    bench_begin();
+    for (int i = 0; i < lanes; ++i) {
+        memset(&sl[i], 0, sizeof(sl[i]));
+        sl[i].checkouts = perLane; sl[i].seed = 1013904223u + 977u * (unsigned)i; sl[i].persist = 1; sl[i].id = i + 1;
+        if (!thread_start(&th[i], stress_lane_run, &sl[i])) { lanes = i; break; }
+    }
+    for (int i = 0; i < lanes; ++i) { thread_join(th[i]); units += sl[i].units; }
+    group_commit_flush();
+    bench_end(name, (long long)lanes * perLane, (double)units);
+    free(sl); free(th);
+}
+
+/* Runs every benchmark against the data files in dir. The checkout
+   benchmarks run last and append to that directory's receipts. */
+int run_benchmarks(const char *dir) {
+#ifdef _WIN32
+    if (_chdir(dir) != 0) { printf("Cannot enter %s\n", dir); return 0; }
+#else
+    if (chdir(dir) != 0) { printf("Cannot enter %s\n", dir); return 0; }
+#endif
+    unsigned seed = 2463534242u;
+    printf("{\"dataset\":\"%s\",\"products_bytes\":%lld,\"receipts_bytes\":%lld,\"customers_bytes\":%lld}\n",
+           dir, file_size(PRODUCTS_FILE), file_size(RECEIPTS_FILE), file_size(CUSTOMERS_FILE));
+
+    Catalog tmp;
+    uint32_t version;
+    memset(&tmp, 0, sizeof(tmp));
+    bench_begin();
+    int n = load_products_file(PRODUCTS_FILE, &tmp);
+    bench_end("load_products_csv", 1, n);
+    if (n <= 0) { printf("No products in %s\n", dir); return 0; }
+    bench_begin();
+    save_products_bin("bench_products.bin", &tmp);
+    bench_end("save_products_bin", 1, n);
+    catalog_free(&tmp);
+    bench_begin();
+    n = load_products_bin("bench_products.bin", &tmp, &version);
+    bench_end("load_products_bin", 1, n);
+    catalog_free(&tmp);
+    remove("bench_products.bin");
+
+    bench_begin();
+    Catalog *c = catalog_get();
+    bench_end("catalog_get", 1, c->count);
+
+    const int lookups = 1000000;
+    int *codes = xrealloc(NULL, sizeof(int) * lookups);
+    for (int i = 0; i < lookups; ++i) codes[i] = c->code[next_rand(&seed) % (unsigned)c->count];
+    long long hits = 0;
+    bench_begin();
+    for (int i = 0; i < lookups; ++i) hits += catalog_find(codes[i]) >= 0;
+    bench_end("catalog_find_hit", lookups, (double)hits);
+    hits = 0;
+    bench_begin();
+    for (int i = 0; i < lookups; ++i) hits += catalog_find(-1 - codes[i]) >= 0;
+    bench_end("catalog_find_miss", lookups, (double)hits);
+    free(codes);
+
+    const int searches = 1000;
+    char (*terms)[8] = xrealloc(NULL, sizeof(*terms) * searches);
+    for (int i = 0; i < searches; ++i) {
+        const char *nm = catalog_name(c, (int)(next_rand(&seed) % (unsigned)c->count));
+        size_t len = strlen(nm), at = len > 5 ? next_rand(&seed) % (unsigned)(len - 5) : 0;
+        snprintf(terms[i], sizeof(terms[i]), "%.5s", nm + at);
+    }
+    int out[SEARCH_MAX_RESULTS];
+    hits = 0;
+    bench_begin();
+    for (int i = 0; i < searches; ++i) hits += name_index_search(terms[i], out, SEARCH_MAX_RESULTS);
+    bench_end("name_index_search", searches, (double)hits);
+    free(terms);
+
+    if (receipt_log_size() > 0) {
+        bench_begin();
+        g_sales.loaded = 1;     // sales_store_rebuild() without its message
+        if (sales_store_reset()) sales_ingest();
+        bench_end("sales_store_rebuild", 1, g_sales.meta.rows);
+        bench_begin();
+        rollups_rebuild();
+        bench_end("rollups_rebuild", 1, g_rollups.t[RU_PRODUCT_DAY].count);
+        rollups_clear();
+        g_rollups.loaded = 0;
+        bench_begin();
+        rollups_get();
+        bench_end("rollups_load", 1, g_rollups.t[RU_PRODUCT_DAY].count);
+
+        int *days, nd = rollup_days(0, INT_MAX, &days);
+        Money sum = 0;
+        bench_begin();
+        for (int i = 0; i < 1000; ++i) sum += income_total();
+        bench_end("report_total_income", 1000, sum / 1000 / 100.0);
+        sum = 0;
+        bench_begin();
+        for (int i = 0; i < nd; ++i) sum += income_days(days[i], days[i]);
+        bench_end("report_daily_income", nd, sum / 100.0);
+        sum = 0;
+        bench_begin();
+        for (int i = 0; i < nd; ++i) sum += income_month(days[i] / 100);
+        bench_end("report_monthly_income", nd, sum / 100.0);
+        sum = 0;
+        bench_begin();
+        for (int i = 0; i < 100 && nd > 0; ++i) sum += income_days(days[0], days[nd - 1]);
+        bench_end("report_income_range", 100, sum / 100 / 100.0);
+        free(days);
+        sales_column(SC_DAY); sales_column(SC_AMOUNT);
+        sum = 0;
+        bench_begin();
+        for (int i = 0; i < 10; ++i) sum += sales_revenue(0, INT_MAX);
+        bench_end("sales_revenue_scan", 10LL * g_sales.meta.rows, sum / 10 / 100.0);
+
+        sum = 0;
+        bench_begin();
+        for (int i = 0; i < 1000; ++i) {
+            RollupEntry *rows;
+            int m = product_sales_by_day(c->code[next_rand(&seed) % (unsigned)c->count], 0, INT_MAX, &rows);
+            for (int j = 0; j < m; ++j) sum += rows[j].revenue;
+            free(rows);
+        }
+        bench_end("report_product_wise", 1000, sum / 100.0);
+
+        TopSeller *all, top[10];
+        sum = 0;
+        bench_begin();
+        for (int i = 0; i < 10; ++i) {
+            int m = top_sellers_aggregate(0, INT_MAX, &all);
+            int k = top_sellers_select(all, m, -1, 10, top);
+            sum += k ? top[0].revenue : 0;
+            free(all);
+        }
+        bench_end("report_top_selling", 10, sum / 10 / 100.0);
+        sum = 0;
+        bench_begin();
+        int m = top_sellers_aggregate(0, INT_MAX, &all);
+        for (int id = 0; id < c->categories.count; ++id) {
+            int k = top_sellers_select(all, m, id, 10, top);
+            sum += k ? top[0].revenue : 0;
+        }
+        free(all);
+        bench_end("report_top_selling_by_category", 1, sum / 100.0);
+    }
+
+    if (file_size(CUSTOMERS_FILE) > 0 || file_size(CUSTOMERS_DB_FILE) > 0) {
+        Customer hitsOut[SEARCH_MAX_RESULTS], one;
+        char term[64];
+        if (file_size(CUSTOMERS_FILE) > 0) {
+            bench_begin();
+            int n = customers_import_csv(CUSTOMERS_FILE);
+            bench_end("customer_store_import", 1, n);
+        }
+        bench_begin();
+        CustomerStore *cs = customer_store_get();
+        bench_end("customer_store_load", 1, cs->count);
+        int maxId = cs->lastId > 0 ? cs->lastId : 1;
+        const int lookups = 100000;
+        hits = 0;
+        bench_begin();
+        for (int i = 0; i < lookups; ++i) hits += customer_find_id(1 + (int)(next_rand(&seed) % (unsigned)maxId)) >= 0;
+        bench_end("customer_find_id", lookups, (double)hits);
+        hits = 0;
+        bench_begin();
+        for (int i = 0; i < 10000; ++i) {
+            snprintf(term, sizeof(term), "%d", 1 + (int)(next_rand(&seed) % (unsigned)maxId));
+            hits += customer_search(term, hitsOut, SEARCH_MAX_RESULTS);
+        }
+        bench_end("customer_search_id", 10000, (double)hits);
+        hits = 0;
+        bench_begin();
+        for (int i = 0; i < 10000 && cs->count > 0; ++i) {
+            if (!customer_read((int)(next_rand(&seed) % (unsigned)cs->count), &one)) continue;
+            hits += customer_search(one.phone, hitsOut, SEARCH_MAX_RESULTS);
+        }
+        bench_end("customer_search_phone", 10000, (double)hits);
+        bench_begin();
+        if (!cs->nameIndexed) customer_name_index_build();
+        bench_end("customer_name_index_build", 1, cs->nameKeys);
+        hits = 0;
+        bench_begin();
+        for (int i = 0; i < 1000; ++i) {
+            gen_customer_name(1 + (int)(next_rand(&seed) % (unsigned)maxId), term, sizeof(term));
+            hits += customer_search(term, hitsOut, SEARCH_MAX_RESULTS);
+        }
+        bench_end("customer_search_name", 1000, (double)hits);
+        Money sum = 0;
+        bench_begin();
+        ReceiptIndex *ri = receipt_index_get();
+        bench_end("receipt_index_get", 1, ri->count);
+        bench_begin();
+        for (int i = 0; i < 1000; ++i) {
+            gen_customer_name(1 + (int)(next_rand(&seed) % (unsigned)maxId), term, sizeof(term));
+            customer_receipts(term, 0, 0, 0, HISTORY_PAGE, bench_count_receipt, &sum);
+        }
+        bench_end("customer_receipts_page", 1000, sum / 100.0);
+    }
+
+    bench_checkouts("checkout_1_lane", 1, 5000);
+    bench_checkouts("checkout_8_lanes", 8, 2500);
+    return 1;
+}
+
+static void print_usage(const char *prog) {
+    printf("Usage: %s [options] [--import-csv [products.txt]] [--export-csv [products.txt]] [--low-stock] [--rebuild-sales] [--rebuild-rollups] [--rebuild-receipt-index] [--compact-receipts] [--export-sales-items [file]] [--reprint-bill RECEIPT_ID] [--import-customers [file]] [--export-customers [file]] [--batch FILE|- [lanes [bills]]] [--stress-lanes N [checkouts [persist]]] [--gen-data DIR ...] [--bench DIR]\n", prog);
+    printf("  --import-csv  convert the CSV catalog into %s (used instead of CSV when present)\n", PRODUCTS_BIN_FILE);
+    printf("  --export-csv  write %s back out in the CSV layout\n", PRODUCTS_BIN_FILE);
+    printf("  --low-stock   print code,name,stock,threshold for every product below its reorder threshold\n");
+    printf("  --rebuild-sales  regenerate the %s/ report store from %s\n", SALES_STORE_DIR, RECEIPTS_FILE);
+    printf("  --import-customers [customers.txt]  rebuild %s from the CSV layout (done automatically if it is missing)\n", CUSTOMERS_DB_FILE);
+    printf("  --export-customers [customers.txt]  write %s back out in the CSV layout\n", CUSTOMERS_DB_FILE);
+    printf("  --rebuild-rollups  regenerate %s (daily/monthly/product totals) from %s\n", ROLLUP_FILE, RECEIPTS_FILE);
+    printf("  --rebuild-receipt-index  regenerate %s (receipts by customer) from %s\n", RECEIPT_INDEX_FILE, RECEIPTS_FILE);
+    printf("  --compact-receipts  merge the sealed %s/ segments of each past month into one\n", RECEIPT_SEG_DIR);
+    printf("  --export-sales-items [%s]  write every receipt line as code,name,qty,unit,subtotal,timestamp\n", SALES_ITEMS_FILE);
+    printf("  --reprint-bill  print the saved bill of a receipt from the %s/ archive\n", BILLS_DIR);
+    printf("  --batch       check out every \"customer,code,qty[,code,qty...]\" line of FILE (- for stdin) on `lanes`\n");
+    printf("                threads and report throughput and latency; bill files only with bills=1\n");
+    printf("  --gen-data DIR [skus [receipt_lines [customers]]]  write synthetic data files into DIR\n");
+    printf("  --bench DIR   time catalog, search, report, customer and checkout paths on DIR's data (JSON lines)\n");
+    printf("  --stress-lanes  run N concurrent checkout lanes on random carts and verify stock (carts are cancelled at checkout\n");
+    printf("                unless persist=1, which saves them)\n");
+    printf("Options:\n");
+    printf("  --durability async|write|fsync  return before the write, after it (default), or after fsync\n");
+    printf("  --commit-window USEC  wait up to USEC for more checkouts to join a batch (default 0)\n");
+    printf("  --commit-batch N      stop waiting once N checkouts are queued (default 256)\n");
+    printf("  --stats-file PATH     rewrite PATH with per-stage checkout latency every --stats-interval\n");
+    printf("  --stats-interval SEC  seconds between stats file rewrites (default %d)\n", STATS_DUMP_INTERVAL);
+    printf("  --scan-threads N      threads for full scans of the receipt log when rebuilding (default: one per CPU)\n");
+}
+
+/* Parses the commit, stats and scan options at argv[i]; returns how many
+   arguments were used, 0 if argv[i] is not one, or -1 on a bad value. */
+static int parse_run_option(int argc, char **argv, int i) {
+    if (i + 1 >= argc) return 0;
+    const char *opt = argv[i], *val = argv[i + 1];
+    if (strcmp(opt, "--durability") == 0) {
+        if (strcmp(val, "async") == 0) g_commitConfig.durability = DURABILITY_ASYNC;
+        else if (strcmp(val, "write") == 0) g_commitConfig.durability = DURABILITY_WRITE;
+        else if (strcmp(val, "fsync") == 0) g_commitConfig.durability = DURABILITY_FSYNC;
+        else return -1;
+        return 2;
+    }
+    if (strcmp(opt, "--commit-window") == 0) {
+        g_commitConfig.windowUs = atoi(val);
+        return g_commitConfig.windowUs >= 0 ? 2 : -1;
+    }
+    if (strcmp(opt, "--commit-batch") == 0) {
+        g_commitConfig.maxBatch = atoi(val);
+        return g_commitConfig.maxBatch > 0 ? 2 : -1;
+    }
+    if (strcmp(opt, "--stats-file") == 0) {
+        g_statsFile = val;
+        return 2;
+    }
+    if (strcmp(opt, "--stats-interval") == 0) {
+        g_statsInterval = atoi(val);
+        return g_statsInterval > 0 ? 2 : -1;
+    }
+    if (strcmp(opt, "--scan-threads") == 0) {
+        g_scanThreads = atoi(val);
+        return g_scanThreads > 0 ? 2 : -1;
+    }
+    return 0;
 }
 
-int main(void) {
+int main(int argc, char **argv) {
+    int argi = 1;
+    while (argi < argc) {
+        int used = parse_run_option(argc, argv, argi);
+        if (used < 0) { print_usage(argv[0]); return 1; }
+        if (used == 0) break;
+        argi += used;
+    }
+    stats_reset();
+    if (g_statsFile) stats_start_dumper();
+    atexit(group_commit_flush);     // async checkouts still queued at exit
+    if (argi < argc) {
+        const char *cmd = argv[argi];
+        int nargs = argc - argi - 1;
+        char **args = argv + argi + 1;
+        const char *csv = nargs > 0 ? args[0] : PRODUCTS_FILE;
+        if (strcmp(cmd, "--gen-data") == 0 && nargs > 0)
+            return gen_data(args[0], nargs > 1 ? atoi(args[1]) : 10000, nargs > 2 ? atoll(args[2]) : 1000000,
+                            nargs > 3 ? atoi(args[3]) : 100000) ? 0 : 1;
+        if (strcmp(cmd, "--bench") == 0 && nargs > 0) return run_benchmarks(args[0]) ? 0 : 1;
+        catalog_get();
+        catalog_checkpoint();   // fold pending stock movements before converting
+        if (strcmp(cmd, "--import-csv") == 0) return catalog_import_csv(csv, PRODUCTS_BIN_FILE) ? 0 : 1;
+        if (strcmp(cmd, "--export-csv") == 0) return catalog_export_csv(PRODUCTS_BIN_FILE, csv) ? 0 : 1;
+        if (strcmp(cmd, "--low-stock") == 0) { low_stock_print_csv(); return 0; }
+        if (strcmp(cmd, "--rebuild-sales") == 0) return sales_store_rebuild() ? 0 : 1;
+        if (strcmp(cmd, "--rebuild-rollups") == 0) return rollups_rebuild() ? 0 : 1;
+        if (strcmp(cmd, "--rebuild-receipt-index") == 0) return receipt_index_rebuild() ? 0 : 1;
+        if (strcmp(cmd, "--compact-receipts") == 0) return receipt_log_compact() ? 0 : 1;
+        if (strcmp(cmd, "--export-sales-items") == 0) return sales_items_export(nargs > 0 ? args[0] : SALES_ITEMS_FILE) ? 0 : 1;
+        if (strcmp(cmd, "--reprint-bill") == 0 && nargs > 0) return bill_reprint(atoi(args[0])) ? 0 : 1;
+        if (strcmp(cmd, "--import-customers") == 0) {
+            int n = customers_import_csv(nargs > 0 ? args[0] : CUSTOMERS_FILE);
+            if (n >= 0) printf("Imported %d customers into %s.\n", n, CUSTOMERS_DB_FILE);
+            return n >= 0 ? 0 : 1;
+        }
+        if (strcmp(cmd, "--export-customers") == 0) return customers_export_csv(nargs > 0 ? args[0] : CUSTOMERS_FILE) ? 0 : 1;
+        if (strcmp(cmd, "--batch") == 0 && nargs > 0)
+            return batch_checkout(args[0], nargs > 1 ? atoi(args[1]) : 1, nargs > 2 ? atoi(args[2]) : 0) ? 0 : 1;
+        if (strcmp(cmd, "--stress-lanes") == 0 && nargs > 0)
+            return stress_lanes(atoi(args[0]), nargs > 1 ? atoi(args[1]) : 1000, nargs > 2 ? atoi(args[2]) : 0) ? 0 : 1;
+        print_usage(argv[0]);
+        return 1;
+    }
     ensure_bills_dir();
     while (1) {
         clear_console();
@@ -917,19 +6094,14 @@ void pause_console() {
 }
 
 void view_customers() {
-    FILE *fp = fopen("customers.txt", "r");
-    if (!fp) { printf("No customers found.\n"); return; }
+    CustomerStore *cs = customer_store_get();
+    if (!cs->fp || cs->count == 0) { printf("No customers found.\n"); return; }
     Customer c;
-    int found = 0;
     printf("+----+----------------------+---------------+---------------------------+--------------------------+\n");
     printf("| ID | Name                 | Phone         | Email                     | Address                  |\n");
     printf("+----+----------------------+---------------+---------------------------+--------------------------+\n");
-    while (fscanf(fp, "%d,%49[^,],%14[^,],%49[^,],%99[^\n]\n", &c.id, c.name, c.phone, c.email, c.address) == 5) {
-        printf("| %-2d | %-20s | %-13s | %-25s | %-24s |\n", c.id, c.name, c.phone, c.email, c.address);
-        found = 1;
-    }
+    customer_seek(0);   // records are read back to back from here
+    for (int i = 0; i < cs->count && fread(&c, sizeof(c), 1, cs->fp) == 1; ++i) print_customer_row(&c);
     printf("+----+----------------------+---------------+---------------------------+--------------------------+\n");
-    fclose(fp);
-    if (!found) printf("No customers found.\n");
 }
 